@@ -1,83 +1,34 @@
 ﻿#include "Application.h"
+#include "Shader.h"
 
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
-
-static std::string ReadFile(const char* path)
-{
-    std::ifstream in(path, std::ios::in | std::ios::binary);
-    if (!in) throw std::runtime_error(std::string("Failed to open file: ") + path);
-
-    std::ostringstream ss;
-    ss << in.rdbuf();
-    return ss.str();
-}
-
-static GLuint CompileShader(GLenum type, const std::string& src, const char* debugName)
-{
-    GLuint sh = glCreateShader(type);
-    const char* csrc = src.c_str();
-    glShaderSource(sh, 1, &csrc, nullptr);
-    glCompileShader(sh);
-
-    GLint ok = 0;
-    glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
-    if (!ok)
-    {
-        GLint len = 0;
-        glGetShaderiv(sh, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, '\0');
-        glGetShaderInfoLog(sh, len, nullptr, log.data());
-        glDeleteShader(sh);
-        throw std::runtime_error(std::string("Shader compile failed (") + debugName + "):\n" + log);
-    }
-    return sh;
-}
-
-static GLuint LinkProgram(GLuint vs, GLuint fs)
-{
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok)
-    {
-        GLint len = 0;
-        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, '\0');
-        glGetProgramInfoLog(prog, len, nullptr, log.data());
-        glDeleteProgram(prog);
-        throw std::runtime_error(std::string("Program link failed:\n") + log);
-    }
-
-
-    glDetachShader(prog, vs);
-    glDetachShader(prog, fs);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
-    return prog;
-}
+#include <cfloat>
+#include <algorithm>
 
 float rng(float s)
 {
     return s * rand() / RAND_MAX;
 }
 
-Application::Application()
+Application::Application(const HeadlessSettings& headless) : headless(headless)
 {
     cam = Camera();
 
+    // the layers are known up front, the images stream in once the context exists
+    materials.scan(MATERIAL_DIR);
 
     initializeGame();
 
+    // no display server needed: GLFW's null platform only hands out offscreen contexts
+    if (headless.enabled)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
     if (!glfwInit())
         throw std::runtime_error("GLFW could not initialize!");
 
@@ -85,23 +36,39 @@ Application::Application()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-    windowed_width = int(mode->width * 0.8f);
-    windowed_height = int(mode->height * 0.8f);
+    if (headless.enabled)
+    {
+        // surfaceless EGL first, OSMesa where there is no EGL
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        window = glfwCreateWindow(headless.width, headless.height, "Kodor", nullptr, nullptr);
 
-    window = glfwCreateWindow(
-        windowed_width,
-        windowed_height,
-        "Kodor",
-        nullptr, nullptr
-    );
+        if (!window)
+        {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            window = glfwCreateWindow(headless.width, headless.height, "Kodor", nullptr, nullptr);
+        }
+    }
+    else
+    {
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        windowed_width = int(mode->width * 0.8f);
+        windowed_height = int(mode->height * 0.8f);
+
+        window = glfwCreateWindow(
+            windowed_width,
+            windowed_height,
+            "Kodor",
+            nullptr, nullptr
+        );
+    }
 
     if (!window)
     {
         glfwTerminate();
-        throw std::runtime_error("GLFW could not create window!");
+        throw std::runtime_error(headless.enabled ? "GLFW could not create a headless EGL or OSMesa context!" : "GLFW could not create window!");
     }
 
     glfwMakeContextCurrent(window);
@@ -111,17 +78,21 @@ Application::Application()
         glfwTerminate();
     }
 
-    glfwSwapInterval(1);
     glfwSetWindowUserPointer(window, this);
 
+    if (!headless.enabled)
+    {
+        glfwSwapInterval(1);
+
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 
-    glfwSetKeyCallback(window, handle_events);
+        glfwSetKeyCallback(window, handle_events);
 
 
-    initImGui();
+        initImGui();
+    }
 
 
 
@@ -137,22 +108,32 @@ Application::Application()
     GLuint fs = CompileShader(GL_FRAGMENT_SHADER, fsSrc, "frag.glsl");
     shader_program = LinkProgram(vs, fs);
 
-    const std::string csSrc = ReadFile("shaders/compute.glsl");
-
-    GLuint cs = CompileShader(GL_COMPUTE_SHADER, csSrc, "compute.glsl");
-
-    computeProgram = glCreateProgram();
-    glAttachShader(computeProgram, cs);
-    glLinkProgram(computeProgram);
-
-    glDeleteShader(cs);
+    computeProgram = LoadComputeProgram("compute.glsl");
 
 
     u_resolution = glGetUniformLocation(shader_program, "u_resolution");
-    pos_id = glGetUniformLocation(shader_program, "cpos");
-    front_id = glGetUniformLocation(shader_program, "front");
-    right_id = glGetUniformLocation(shader_program, "right");
-    up_id = glGetUniformLocation(shader_program, "up");
+    u_camera = glGetUniformLocation(shader_program, "u_camera");
+    u_use_tiles = glGetUniformLocation(shader_program, "u_use_tiles");
+    u_tiles = glGetUniformLocation(shader_program, "u_tiles");
+    u_render_mode = glGetUniformLocation(shader_program, "u_render_mode");
+    u_use_field = glGetUniformLocation(shader_program, "u_use_field");
+    u_field = glGetUniformLocation(shader_program, "u_field");
+    u_field_cell_radius = glGetUniformLocation(shader_program, "u_field_cell_radius");
+    u_use_bvh = glGetUniformLocation(shader_program, "u_use_bvh");
+    u_lod_pixels = glGetUniformLocation(shader_program, "u_lod_pixels");
+    u_use_seed = glGetUniformLocation(shader_program, "u_use_seed");
+    u_seed_frame = glGetUniformLocation(shader_program, "u_seed_frame");
+    u_camera_shift = glGetUniformLocation(shader_program, "u_camera_shift");
+    u_prev_camera = glGetUniformLocation(shader_program, "u_prev_camera");
+    u_use_cone = glGetUniformLocation(shader_program, "u_use_cone");
+    u_cone_start = glGetUniformLocation(shader_program, "u_cone_start");
+    u_sky = glGetUniformLocation(shader_program, "u_sky");
+    u_materials = glGetUniformLocation(shader_program, "u_materials");
+    u_material_ready = glGetUniformLocation(shader_program, "u_material_ready");
+    u_max_steps = glGetUniformLocation(shader_program, "u_max_steps");
+    u_tolerance = glGetUniformLocation(shader_program, "u_tolerance");
+    u_checker = glGetUniformLocation(shader_program, "u_checker");
+    u_frame_index = glGetUniformLocation(shader_program, "u_frame_index");
     u_dt = glGetUniformLocation(computeProgram, "dt");
 
 
@@ -161,12 +142,26 @@ Application::Application()
     u_arrow_direction = glGetUniformLocation(shader_program, "u_arrow_direction");
     u_arrow_length = glGetUniformLocation(shader_program, "u_arrow_length");
 
-    glGenBuffers(1, &particleSSBO);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
-
+    rewind.init();
+    halo_finder.init();
+    pair_correlation.init();
+    conservation.init();
+    tile_culler.init();
+    impostors.init();
+    distance_field.init();
+    bvh.init();
+    march_seed.init();
+    cone_prepass.init();
+    compute_marcher.init();
+    multi_view.init();
+    sky_map.init();
+    materials.init();
+    picker.init();
+    governor.init();
+    temporal.init();
 
-    const int MAX_SPHERES = 128;
-    glBufferData(GL_SHADER_STORAGE_BUFFER, particles.size() * sizeof(ParticleGPU), particles.data(), GL_DYNAMIC_READ);
+    glGenBuffers(1, &particleSSBO);
+    uploadParticles();
 
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
@@ -176,6 +171,10 @@ Application::Application()
     glfwGetFramebufferSize(window, &fbw, &fbh);
     w = fbw; h = fbh;
     glViewport(0, 0, w, h);
+    scene_target.resize(w, h);
+    temporal.resize(w, h);
+    march_seed.resize(w, h);
+    cone_prepass.resize(w, h);
 
 
     current_clustering_score = calculateClusteringScore();
@@ -185,7 +184,30 @@ Application::~Application()
 {
 
 
-    shutdownImGui();
+    if (!headless.enabled)
+        shutdownImGui();
+
+    // the modules own GL objects, so they go while the context is still current;
+    // their destructors run after glfwTerminate
+    recorder.release();
+    picker.release();
+    materials.release();
+    rewind.release();
+    halo_finder.release();
+    pair_correlation.release();
+    conservation.release();
+    tile_culler.release();
+    impostors.release();
+    distance_field.release();
+    bvh.release();
+    march_seed.release();
+    cone_prepass.release();
+    compute_marcher.release();
+    multi_view.release();
+    sky_map.release();
+    scene_target.release();
+    governor.release();
+    temporal.release();
 
     if (shader_program) glDeleteProgram(shader_program);
     if (computeProgram) glDeleteProgram(computeProgram);
@@ -513,6 +535,13 @@ void Application::renderImGui()
             startNewRound();
         }
 
+        ImGui::Spacing();
+
+        if (rewind.hasRoundStart() && ImGui::Button("Retry This Round", ImVec2(-1, 0)))
+        {
+            retryRound();
+        }
+
         ImGui::End();
     }
 
@@ -537,12 +566,97 @@ void Application::renderImGui()
 
         ImGui::Separator();
 
+        if (ImGui::CollapsingHeader("Conserved Quantities"))
+        {
+            ImGui::SliderFloat("Sample every (s)", &conservation.interval, 0.02f, 2.0f, "%.2f");
+
+            if (!conservation.samples.empty())
+            {
+                const ConservationMonitor::Sample& last = conservation.samples.back();
+                const float* l = last.momentum;
+
+                ImGui::Text("Kinetic: %.5f  Potential: %.5f", last.kinetic, last.potential);
+                ImGui::Text("Total energy: %.5f", last.kinetic + last.potential);
+                ImGui::Text("L: (%.4f, %.4f, %.4f, %.4f, %.4f, %.4f)", l[0], l[1], l[2], l[3], l[4], l[5]);
+
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "energy drift %.2e", conservation.energy_drift.back());
+                ImGui::PlotLines("##energy", conservation.energy_drift.data(), int(conservation.energy_drift.size()),
+                    0, overlay, FLT_MAX, FLT_MAX, ImVec2(-1, 60));
+
+                snprintf(overlay, sizeof(overlay), "|dL|/|L0| %.2e", conservation.momentum_drift.back());
+                ImGui::PlotLines("##momentum", conservation.momentum_drift.data(), int(conservation.momentum_drift.size()),
+                    0, overlay, FLT_MAX, FLT_MAX, ImVec2(-1, 60));
+            }
+            else
+            {
+                ImGui::TextDisabled("No samples yet");
+            }
+
+            if (ImGui::Button("Export conserved_quantities.csv", ImVec2(-1, 0)))
+            {
+                if (conservation.exportCSV("conserved_quantities.csv"))
+                    std::cout << "Exported " << conservation.samples.size() << " conserved quantity samples" << std::endl;
+            }
+        }
+
+        ImGui::Separator();
+
         if (ImGui::CollapsingHeader("Camera"))
         {
             ImGui::Text("Position: (%.2f, %.2f, %.2f, %.2f)",
                 cam.pos.x, cam.pos.y, cam.pos.z, cam.pos.w);
             ImGui::Text("Front: (%.2f, %.2f, %.2f, %.2f)",
                 cam.front.x, cam.front.y, cam.front.z, cam.front.w);
+
+            if (ImGui::Button("Bookmark view"))
+            {
+                camera_bookmark = cam;
+                has_camera_bookmark = true;
+            }
+
+            if (has_camera_bookmark)
+            {
+                ImGui::SameLine();
+                if (ImGui::Button("Fly to bookmark"))
+                {
+                    camera_flight_start = cam;
+                    camera_flight_t = 0.0f;
+                }
+            }
+        }
+
+        ImGui::Separator();
+
+        if (ImGui::CollapsingHeader("Selection"))
+        {
+            if (picker.selected() < 0)
+            {
+                ImGui::TextDisabled("Click a sphere in UI mode to select it");
+            }
+            else if (!picker.particle())
+            {
+                ImGui::Text("Sphere %d", picker.selected());
+                ImGui::TextDisabled("Reading back...");
+            }
+            else
+            {
+                ParticleGPU p;
+                std::memcpy(&p, picker.particle(), sizeof(p));
+
+                ImGui::Text("Sphere %d", picker.selected());
+                ImGui::Text("Position: (%.3f, %.3f, %.3f, %.3f)", p.position.x, p.position.y, p.position.z, p.position.w);
+                ImGui::Text("Velocity: (%.3f, %.3f, %.3f, %.3f)", p.velocity.x, p.velocity.y, p.velocity.z, p.velocity.w);
+                ImGui::Text("Radius: %.4f", p.radius);
+                ImGui::ColorEdit3("Color", &p.color.x, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker);
+                if (p.material >= 0)
+                    ImGui::Text("Material: layer %d", p.material);
+                else
+                    ImGui::TextDisabled("No material");
+            }
+
+            if (picker.selected() >= 0 && ImGui::Button("Clear selection"))
+                picker.clear();
         }
 
         ImGui::Separator();
@@ -596,6 +710,7 @@ void Application::renderImGui()
                         if (distance_3d < 0.3f && dist > catch_radius)
                         {
                             ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "⚠ Close in 3D, FAR in W!");
+                            ImGui::TextDisabled("The Cross-section renderer sliced at World W shows it");
                         }
                     }
                 }
@@ -609,12 +724,7 @@ void Application::renderImGui()
             if (ImGui::Button("Restart Game", ImVec2(-1, 0)))
             {
                 initializeGame();
-
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
-                glBufferData(GL_SHADER_STORAGE_BUFFER,
-                    particles.size() * sizeof(ParticleGPU),
-                    particles.data(),
-                    GL_DYNAMIC_READ);
+                uploadParticles();
             }
 
             ImGui::Spacing();
@@ -623,6 +733,75 @@ void Application::renderImGui()
             {
                 ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Smaller = Harder!");
             }
+
+            ImGui::SliderInt("Bodies", &body_count, 10, 200000, "%d", ImGuiSliderFlags_Logarithmic);
+            ImGui::TextDisabled("Applied on restart");
+        }
+
+        ImGui::Separator();
+
+        if (ImGui::CollapsingHeader("Clusters"))
+        {
+            ImGui::SliderFloat("Linking factor", &halo_finder.linking_factor, 0.05f, 1.0f, "%.2f");
+            ImGui::SliderInt("Min members", &halo_finder.min_members, 2, 32);
+
+            ImGui::Text("Linking length: %.4f rad", halo_finder.linking_length);
+            ImGui::Text("Clusters: %u", halo_finder.cluster_count);
+            ImGui::Text("Grouped bodies: %u / %zu", halo_finder.grouped_particles, particles.size());
+            ImGui::Text("Grouped mass: %.4f", halo_finder.grouped_mass);
+
+            int shown = 0;
+            for (const ClusterFinder::Cluster& c : halo_finder.clusters)
+            {
+                if (shown++ >= 8) break;
+                ImGui::Text("  %3u bodies  m=%.4f  (%.2f, %.2f, %.2f, %.2f)",
+                    c.count, c.mass, c.center.x, c.center.y, c.center.z, c.center.w);
+            }
+        }
+
+        ImGui::Separator();
+
+        if (ImGui::CollapsingHeader("Pair Correlation"))
+        {
+            ImGui::Checkbox("Force sampling", &pair_correlation.force_sampling);
+            ImGui::SliderInt("Samples per body", &pair_correlation.samples_per_body, 16, 4096, "%d", ImGuiSliderFlags_Logarithmic);
+            ImGui::Checkbox("Log to pair_correlation.csv", &pair_correlation.log_to_file);
+
+            if (pair_correlation.hasResult())
+            {
+                ImGui::Text("%s, mean distance %.4f rad, score %.1f",
+                    pair_correlation.sampled ? "Sampled" : "Exact",
+                    pair_correlation.meanDistance(), current_clustering_score);
+
+                ImGui::PlotHistogram("##pairs", pair_correlation.pair_density.data(), PairCorrelation::BINS,
+                    0, "pair distances 0..pi", 0.0f, FLT_MAX, ImVec2(-1, 80));
+                ImGui::PlotLines("##xi", pair_correlation.correlation.data(), PairCorrelation::BINS,
+                    0, "xi(r)", -1.0f, 4.0f, ImVec2(-1, 80));
+            }
+            else
+            {
+                ImGui::TextDisabled("Waiting for the first histogram");
+            }
+        }
+
+        ImGui::Separator();
+
+        if (ImGui::CollapsingHeader("Rewind"))
+        {
+            float history = rewind.newestTime() - rewind.oldestTime();
+            ImGui::Text("History: %.1f s (sim time %.2f s)", history, sim_time);
+
+            if (game_state == GameState::PAUSED || game_state == GameState::GAME_OVER)
+            {
+                if (ImGui::SliderFloat("Seconds back", &rewind_seconds_back, 0.0f, history, "%.2f"))
+                {
+                    scrubRewind(rewind_seconds_back);
+                }
+            }
+            else
+            {
+                ImGui::TextDisabled("Scrubbing is available while paused");
+            }
         }
 
         ImGui::Separator();
@@ -630,6 +809,111 @@ void Application::renderImGui()
         if (ImGui::CollapsingHeader("Rendering"))
         {
             ImGui::ColorEdit3("Background", clear_color);
+            if (materials.count() > 0)
+                ImGui::Text("Materials: %d of %d loaded, %d failed", materials.loaded(), materials.count(), materials.failed());
+            else
+                ImGui::TextDisabled("No materials in %s", MATERIAL_DIR);
+            if (ImGui::SliderFloat("Star density", &sky_map.star_density, 0.0f, 0.05f, "%.3f"))
+                sky_map.bake();
+
+            ImGui::Text("Scene GPU time: %.2f ms at %d x %d", governor.gpu_ms,
+                std::max(1, int(w * governor.render_scale)), std::max(1, int(h * governor.render_scale)));
+            ImGui::Checkbox("Auto quality", &governor.enabled);
+            ImGui::SliderFloat("Frame budget (ms)", &governor.target_ms, 4.0f, 33.0f, "%.1f");
+            ImGui::BeginDisabled(governor.enabled);
+            ImGui::SliderFloat("Render scale", &governor.render_scale, FrameGovernor::MIN_SCALE, FrameGovernor::MAX_SCALE, "%.2f");
+            ImGui::SliderInt("March steps", &governor.max_steps, FrameGovernor::MIN_STEPS, FrameGovernor::MAX_STEPS);
+            ImGui::SliderFloat("Hit tolerance", &governor.tolerance, FrameGovernor::MIN_TOLERANCE, FrameGovernor::MAX_TOLERANCE, "%.3f");
+            ImGui::EndDisabled();
+            ImGui::Text("F11 toggles fullscreen");
+            ImGui::Separator();
+
+            const char* render_modes[] = { "Sphere tracing", "Analytic", "Impostor raster", "Point splats", "Cross-section" };
+            ImGui::Combo("Renderer", &render_mode, render_modes, IM_ARRAYSIZE(render_modes));
+            ImGui::Checkbox("Splat when mostly sub-pixel", &auto_splat);
+            if (auto_splatting)
+                ImGui::Text("Auto splatting: %.0f%% of spheres sub-pixel", 100.0f * impostors.subpixelShare());
+            if (scene_mode == 2)
+                ImGui::Text("Impostors drawn: %u", impostors.visible);
+            if (scene_mode == 3)
+                ImGui::Text("Impostors drawn: %u, splats: %u", impostors.visible, impostors.splatted);
+            if (render_mode == 4)
+            {
+                const char* slice_axes[] = { "Camera up (great sphere)", "World W", "World X", "World Y", "World Z" };
+                ImGui::Combo("Slice normal", &slice_axis, slice_axes, IM_ARRAYSIZE(slice_axes));
+                ImGui::TextDisabled("Spheres cut by the 3D slice through the camera");
+                ImGui::Text("Cross-sections drawn: %u", impostors.visible);
+            }
+            if (render_mode < 2)
+            {
+                const char* patterns[] = { "Off", "Half", "Quarter" };
+                ImGui::Combo("Checkerboard", &checkerboard, patterns, IM_ARRAYSIZE(patterns));
+            }
+            if (render_mode == 0)
+            {
+                ImGui::Checkbox("Compute marcher (8x8 groups)", &use_compute_marcher);
+                if (use_compute_marcher)
+                    ImGui::Text("%s", checkerboard != 0 ? "Off while checkerboarding" :
+                        compute_marcher.subgroups() ? "Culling with subgroup ops" : "Culling in shared memory");
+                ImGui::BeginDisabled(use_compute_marcher && checkerboard == 0);
+                ImGui::Checkbox("Distance field skipping", &use_distance_field);
+                ImGui::Checkbox("Sphere BVH", &use_bvh);
+                if (use_bvh)
+                {
+                    ImGui::Checkbox("Cluster LOD", &use_cluster_lod);
+                    if (use_cluster_lod)
+                        ImGui::SliderFloat("LOD cluster size (px)", &lod_pixels, 1.0f, 16.0f, "%.1f");
+                }
+                ImGui::Checkbox("Seed march from last frame", &use_march_seed);
+                ImGui::EndDisabled();
+                ImGui::Checkbox("Cone march prepass (1/8 res)", &use_cone_prepass);
+            }
+            ImGui::Checkbox("Tile culling", &use_tile_culling);
+            if (use_tile_culling)
+                ImGui::Text("Tiles: %d x %d (%d px)", tile_culler.tilesX(), tile_culler.tilesY(), TileCuller::TILE_SIZE);
+
+            ImGui::Separator();
+            if (!recorder.recording())
+            {
+                const char* sizes[] = { "Full", "Half", "Quarter" };
+                ImGui::Combo("Capture size", &record_scale, sizes, IM_ARRAYSIZE(sizes));
+                if (ImGui::Button("Record to capture.y4m"))
+                {
+                    recorder.scale_divisor = 1 << record_scale;
+                    try
+                    {
+                        recorder.start(record_path, w, h, 60);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::cerr << e.what() << std::endl;
+                    }
+                }
+            }
+            else
+            {
+                ImGui::Text("Recording %d x %d: %u written, %u dropped", recorder.frameWidth(), recorder.frameHeight(),
+                    recorder.written.load(), recorder.dropped);
+                if (ImGui::Button("Stop recording"))
+                    recorder.stop();
+            }
+            ImGui::Separator();
+
+            if (render_mode < 2)
+            {
+                const char* presets[] = { "Single", "Rear view", "W-axis view", "Split screen" };
+                int preset = multi_view.preset;
+                if (ImGui::Combo("Views", &preset, presets, IM_ARRAYSIZE(presets)))
+                {
+                    // player two starts where player one stands
+                    if (preset == MultiView::SPLIT_SCREEN && multi_view.preset != MultiView::SPLIT_SCREEN)
+                        second_cam = cam;
+                    multi_view.preset = preset;
+                }
+                if (views_active)
+                    ImGui::Text("%s", multi_view.preset == MultiView::SPLIT_SCREEN ?
+                        "Player two: arrows turn, I/K move, J/L strafe" : "Single pass, no checkerboard, seed or cone");
+            }
         }
 
         ImGui::Separator();
@@ -660,7 +944,7 @@ void Application::initializeGame()
 
     float sizes[10] = { 0.08f, 0.04f, 0.045f, 0.05f, 0.035f, 0.055f, 0.04f, 0.038f, 0.042f, 0.048f };
 
-    for (int i = 0; i < 10; i++)
+    for (int i = 0; i < body_count; i++)
     {
         ParticleGPU particle;
 
@@ -668,7 +952,8 @@ void Application::initializeGame()
 
         particle.velocity = Vec4(rng(2) - 1, rng(2) - 1, rng(2) - 1, rng(2) - 1).normalized() * 0.3f;
 
-        particle.radius = sizes[i];
+        // bodies past the first ten are small debris
+        particle.radius = i < 10 ? sizes[i] : 0.01f + rng(0.02f);
 
         if (i == 0)
         {
@@ -677,6 +962,7 @@ void Application::initializeGame()
         else
         {
             particle.color = Vec3(rng(1), rng(1), rng(1));
+            particle.material = materials.layerFor(i - 1);
         }
 
         particles.push_back(particle);
@@ -703,6 +989,8 @@ void Application::updateGameState(float dt)
     clustering_update_timer += dt;
     if (clustering_update_timer >= CLUSTERING_UPDATE_INTERVAL)
     {
+        halo_finder.dispatch(particleSSBO);
+        pair_correlation.dispatch(particleSSBO, sim_time);
         current_clustering_score = calculateClusteringScore();
         clustering_update_timer = 0.0f;
     }
@@ -717,6 +1005,7 @@ void Application::updateGameState(float dt)
             game_state = GameState::SIMULATION;
             current_round = 1;
             caught_this_round = false;
+            markRoundStart();
         }
         break;
 
@@ -832,23 +1121,10 @@ float Application::calculate4DDistance(const Vec4& a, const Vec4& b)
 
 float Application::calculateClusteringScore()
 {
-    if (particles.size() < 2) return 0.0f;
-
-    float total_distance = 0.0f;
-    int pair_count = 0;
-
-    for (size_t i = 0; i < particles.size(); i++)
-    {
-        for (size_t j = i + 1; j < particles.size(); j++)
-        {
-            total_distance += calculate4DDistance(particles[i].position, particles[j].position);
-            pair_count++;
-        }
-    }
+    // mean pairwise distance from the latest GPU histogram, see PairCorrelation
+    if (particles.size() < 2 || !pair_correlation.hasResult()) return 0.0f;
 
-    if (pair_count == 0) return 0.0f;
-
-    float avg_distance = total_distance / pair_count;
+    float avg_distance = pair_correlation.meanDistance();
 
     float score = 100.0f * (1.0f - avg_distance / 3.14159f);
     if (score < 0.0f) score = 0.0f;
@@ -867,7 +1143,7 @@ void Application::startNewRound()
     if (current_round <= MAX_ROUNDS)
     {
         game_state = GameState::SIMULATION;
-
+        markRoundStart();
     }
     else
     {
@@ -885,11 +1161,111 @@ void Application::applyRedBallVelocity()
 
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
         glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleGPU), &particles[0]);
+        particles_changed = true;
 
         startNewRound();
     }
 }
 
+void Application::uploadParticles()
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+        particles.size() * sizeof(ParticleGPU),
+        particles.data(),
+        GL_DYNAMIC_READ);
+    particles_changed = true;
+
+    sim_time = 0.0f;
+    rewind_seconds_back = 0.0f;
+    rewind.allocate(particles.size(), sizeof(ParticleGPU));
+    float smallest_mass = 0.0f;
+    float total_mass = 0.0f;
+    for (const ParticleGPU& p : particles)
+    {
+        float mass = (4.0f / 3.0f) * 3.14159265359f * p.radius * p.radius * p.radius;
+        smallest_mass = total_mass > 0.0f ? std::min(smallest_mass, mass) : mass;
+        total_mass += mass;
+    }
+    halo_finder.allocate(particles.size(), smallest_mass, total_mass);
+    pair_correlation.allocate(particles.size());
+    conservation.allocate(particles.size());
+    impostors.allocate(particles.size());
+    bvh.allocate(particles.size());
+    march_seed.allocate(particles.size());
+    picker.clear();
+}
+
+void Application::syncParticleMirror()
+{
+    // only the red ball drives game logic, the rest of the state stays on the GPU
+    if (particles.empty()) return;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
+    void* ptr = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleGPU), GL_MAP_READ_BIT);
+    if (ptr)
+    {
+        memcpy(particles.data(), ptr, sizeof(ParticleGPU));
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+}
+
+void Application::stepSimulation(float dt)
+{
+    glUseProgram(computeProgram);
+    glUniform1f(u_dt, dt * simulation_speed);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+
+    glDispatchCompute(particles.size() / 3 + 1, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    particles_changed = true;
+
+    sim_time += dt * simulation_speed;
+    rewind.record(particleSSBO, sim_time);
+    conservation.tick(particleSSBO, sim_time);
+
+    syncParticleMirror();
+}
+
+void Application::markRoundStart()
+{
+    rewind.markRoundStart(particleSSBO, sim_time);
+    round_start_cam = cam;
+    rewind_seconds_back = 0.0f;
+}
+
+void Application::retryRound()
+{
+    if (!rewind.hasRoundStart()) return;
+
+    sim_time = rewind.restoreRoundStart(particleSSBO);
+    particles_changed = true;
+    syncParticleMirror();
+    cam = round_start_cam;
+
+    if (caught_this_round) total_points--;
+    caught_this_round = false;
+
+    round_timer = 0.0f;
+    rewind_seconds_back = 0.0f;
+    show_velocity_editor = false;
+    show_velocity_arrow = false;
+    game_state = GameState::SIMULATION;
+
+    std::cout << "=== RETRYING ROUND " << current_round << " ===" << std::endl;
+}
+
+void Application::scrubRewind(float seconds_back)
+{
+    if (rewind.empty()) return;
+
+    sim_time = rewind.restore(particleSSBO, rewind.newestTime() - seconds_back);
+    particles_changed = true;
+    syncParticleMirror();
+}
+
 
 
 
@@ -900,6 +1276,9 @@ void Application::handle_events(GLFWwindow* window, int key, int scancode, int a
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+        app->toggleFullscreen();
+
     if (key == GLFW_KEY_C && action == GLFW_PRESS)
     {
         app->ui_mode = !app->ui_mode;
@@ -915,8 +1294,30 @@ void Application::handle_events(GLFWwindow* window, int key, int scancode, int a
     }
 }
 
+void Application::toggleFullscreen()
+{
+    if (!is_fullscreen)
+    {
+        glfwGetWindowPos(window, &windowed_pos_x, &windowed_pos_y);
+        glfwGetWindowSize(window, &windowed_width, &windowed_height);
+
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+        glfwSetWindowMonitor(window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+    }
+    else
+    {
+        glfwSetWindowMonitor(window, nullptr, windowed_pos_x, windowed_pos_y, windowed_width, windowed_height, 0);
+    }
+
+    is_fullscreen = !is_fullscreen;
+}
+
 int Application::run()
 {
+    if (headless.enabled)
+        return runHeadless();
+
     float tim = 0.0f;
     float last_time = glfwGetTime();
     float new_time = 0;
@@ -926,19 +1327,65 @@ int Application::run()
     double nx, ny;
     glfwGetCursorPos(window, &ox, &oy);
 
+    bool idle = false;
+
     while (!glfwWindowShouldClose(window))
     {
+        // the last frame reused the cached scene and nothing animates: sleep until
+        // input or the timeout, then carry on as if a single frame had passed
+        if (idle)
+        {
+            glfwWaitEventsTimeout(IDLE_WAIT);
+            last_time = glfwGetTime() - IDLE_FRAME_DT;
+        }
+
         new_time = glfwGetTime();
         dt = new_time - last_time;
         last_time = new_time;
 
         glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
-        glClear(GL_COLOR_BUFFER_BIT);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glfwPollEvents();
 
+        // window resized or switched to fullscreen, nothing to draw while minimized
+        int fbw, fbh;
+        glfwGetFramebufferSize(window, &fbw, &fbh);
+        if (fbw == 0 || fbh == 0)
+        {
+            glfwWaitEvents();
+            last_time = glfwGetTime();
+            continue;
+        }
+        if (fbw != w || fbh != h)
+        {
+            w = fbw; h = fbh;
+            scene_target.resize(w, h);
+            temporal.resize(w, h);
+            march_seed.resize(w, h);
+            cone_prepass.resize(w, h);
+        }
+
+        governor.update();
+
+        halo_finder.poll();
+        pair_correlation.poll();
+        conservation.poll();
+        impostors.poll();
+        recorder.poll();
+        materials.poll();
+        picker.poll();
+
         updateGameState(dt);
 
+        if (camera_flight_t >= 0.0f)
+        {
+            camera_flight_t = std::min(1.0f, camera_flight_t + dt / CAMERA_FLIGHT_DURATION);
+            float t = camera_flight_t * camera_flight_t * (3.0f - 2.0f * camera_flight_t);
+            cam = Camera::interpolate(camera_flight_start, camera_bookmark, t);
+            if (camera_flight_t >= 1.0f) camera_flight_t = -1.0f;
+        }
+
         if (!ui_mode)
         {
             glfwGetCursorPos(window, &nx, &ny);
@@ -962,65 +1409,398 @@ int Application::run()
                     cam.move_up(dt);
                 if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
                     cam.move_up(-dt);
+
+                if (views_active && multi_view.preset == MultiView::SPLIT_SCREEN)
+                {
+                    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+                        second_cam.yaw(-dt);
+                    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+                        second_cam.yaw(dt);
+                    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+                        second_cam.pitch(-dt);
+                    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+                        second_cam.pitch(dt);
+                    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS)
+                        second_cam.move_forward(dt);
+                    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+                        second_cam.move_forward(-dt);
+                    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
+                        second_cam.move_right(dt);
+                    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+                        second_cam.move_right(-dt);
+                }
             }
         }
         else
         {
             glfwGetCursorPos(window, &ox, &oy);
+
+            // a click outside the UI picks the sphere under the cursor
+            bool mouse_down = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+            if (mouse_down && !mouse_was_down && !ImGui::GetIO().WantCaptureMouse)
+            {
+                int win_w, win_h;
+                glfwGetWindowSize(window, &win_w, &win_h);
+                if (win_w > 0 && win_h > 0)
+                {
+                    double scale_x = double(w) / win_w * governor.render_scale;
+                    double scale_y = double(h) / win_h * governor.render_scale;
+                    int scene_h = std::max(1, int(h * governor.render_scale));
+                    picker.request(int(ox * scale_x), scene_h - 1 - int(oy * scale_y));
+                }
+            }
+            mouse_was_down = mouse_down;
         }
 
-        if ((game_state == GameState::SIMULATION || game_state == GameState::INTRO) && particles.size() > 0)
+        bool simulating = (game_state == GameState::SIMULATION || game_state == GameState::INTRO) && particles.size() > 0;
+        if (simulating)
         {
-            glUseProgram(computeProgram);
-            glUniform1f(u_dt, dt * simulation_speed);
+            stepSimulation(dt);
+        }
 
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+        float frame[16];
+        cam.frame_matrix(frame);
 
-            glDispatchCompute(particles.size() / 3 + 1, 1, 1);
+        // scene at the governed scale into the offscreen target, then upscaled
+        int scene_w = std::max(1, int(w * governor.render_scale));
+        int scene_h = std::max(1, int(h * governor.render_scale));
 
-            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        const RenderTarget& output = updateScene(frame, scene_w, scene_h);
+        output.blitTo(0, scene_w, scene_h, w, h);
+        recorder.capture(output, scene_w, scene_h);
+        glViewport(0, 0, w, h);
 
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleSSBO);
-            void* ptr = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
-            if (ptr)
-            {
-                memcpy(particles.data(), ptr, particles.size() * sizeof(ParticleGPU));
-                glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-            }
-        }
+        renderImGui();
 
-        glUseProgram(shader_program);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
-        glBindVertexArray(vao);
+        // the UI may just have resumed the game or changed the scene, which shows
+        // up next frame, so only sleep if it did not
+        simulating = (game_state == GameState::SIMULATION || game_state == GameState::INTRO) && particles.size() > 0;
+        idle = !simulating && camera_flight_t < 0.0f && !recorder.recording() && !picker.pickPending() &&
+            sceneCached(scene_w, scene_h);
 
-        if (u_resolution != -1) glUniform2f(u_resolution, float(w), float(h));
+        glfwSwapBuffers(window);
+    }
+
+    return 0;
+}
 
-        if (pos_id != -1) glUniform4f(pos_id, cam.pos.x, cam.pos.y, cam.pos.z, cam.pos.w);
-        if (front_id != -1) glUniform4f(front_id, cam.front.x, cam.front.y, cam.front.z, cam.front.w);
-        if (up_id != -1) glUniform4f(up_id, cam.up.x, cam.up.y, cam.up.z, cam.up.w);
-        if (right_id != -1) glUniform4f(right_id, cam.right.x, cam.right.y, cam.right.z, cam.right.w);
+// Fixed resolution, fixed time step frames with no window, input or UI. Prints
+// the timings and writes the frames asked for as binary PPM.
+int Application::runHeadless()
+{
+    // full resolution and constant quality, so runs stay comparable
+    governor.enabled = false;
+    governor.render_scale = 1.0f;
 
-        if (u_show_arrow != -1) glUniform1i(u_show_arrow, show_velocity_arrow ? 1 : 0);
+    std::vector<unsigned char> pixels;
 
-        if (show_velocity_arrow && particles.size() > 0)
-        {
-            Vec4 arrow_start = particles[0].position;
-            Vec4 arrow_dir = red_ball_velocity_input.normalized();
-            float arrow_len = velocity_magnitude * 0.5f;
+    // each frame is finished before the next starts; the first one also compiles
+    // pipelines and fills caches, so it is reported on its own
+    double first_ms = 0.0;
+    double total_ms = 0.0;
+
+    if (!headless.record.empty())
+        recorder.start(headless.record, w, h, std::max(1, int(std::lround(1.0f / headless.dt))));
+
+    for (int i = 0; i < headless.frames; i++)
+    {
+        double start = glfwGetTime();
 
-            if (u_arrow_start != -1) glUniform4f(u_arrow_start, arrow_start.x, arrow_start.y, arrow_start.z, arrow_start.w);
-            if (u_arrow_direction != -1) glUniform4f(u_arrow_direction, arrow_dir.x, arrow_dir.y, arrow_dir.z, arrow_dir.w);
-            if (u_arrow_length != -1) glUniform1f(u_arrow_length, arrow_len);
+        halo_finder.poll();
+        pair_correlation.poll();
+        conservation.poll();
+        impostors.poll();
+        recorder.poll();
+        materials.poll();
+        picker.poll();
+
+        updateGameState(headless.dt);
+
+        // nobody is there to press a button: a finished round carries on with the
+        // current velocities and the bodies keep moving after the last one
+        if (game_state == GameState::PAUSED)
+            startNewRound();
+
+        if (!particles.empty())
+        {
+            stepSimulation(headless.dt);
         }
 
-        glDisable(GL_DEPTH_TEST);
+        float frame[16];
+        cam.frame_matrix(frame);
 
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        const RenderTarget& output = updateScene(frame, w, h);
+        recorder.capture(output, w, h);
+        glFinish();
 
-        renderImGui();
+        double ms = (glfwGetTime() - start) * 1000.0;
+        if (i == 0)
+            first_ms = ms;
+        else
+            total_ms += ms;
 
-        glfwSwapBuffers(window);
+        bool every_frame = headless.output.find('%') != std::string::npos;
+        if (headless.output.empty() || (!every_frame && i + 1 < headless.frames))
+            continue;
+
+        // ParseArguments only lets a single %d through as the format
+        char path[512];
+        if (every_frame)
+            std::snprintf(path, sizeof(path), headless.output.c_str(), i);
+        else
+            std::snprintf(path, sizeof(path), "%s", headless.output.c_str());
+
+        pixels.resize(size_t(w) * h * 3);
+        output.readPixels(w, h, pixels.data());
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Could not write " + std::string(path));
+
+        file << "P6\n" << w << " " << h << "\n255\n";
+        for (int y = h - 1; y >= 0; y--)
+            file.write(reinterpret_cast<const char*>(pixels.data() + size_t(y) * w * 3), std::streamsize(w) * 3);
+    }
+
+    if (recorder.recording())
+    {
+        recorder.stop();
+        std::cout << "Recorded " << recorder.written << " frames to " << headless.record
+            << " (" << recorder.dropped << " dropped)\n";
     }
 
+    std::cout << "Headless: " << headless.frames << " frames at " << w << " x " << h
+        << " on " << glGetString(GL_RENDERER) << "\n"
+        << "  first frame " << first_ms << " ms, then " << (headless.frames > 1 ? total_ms / (headless.frames - 1) : 0.0)
+        << " ms/frame" << std::endl;
+
     return 0;
-}
\ No newline at end of file
+}
+
+// Renders the scene into the offscreen targets if it changed and returns the
+// target holding the full scene image.
+const RenderTarget& Application::updateScene(const float frame[16], int scene_w, int scene_h)
+{
+    // extra views are marched in the same pass, the rasters only know one camera
+    views_active = multi_view.preset != MultiView::SINGLE && render_mode < 2;
+
+    // very large populations of mostly sub-pixel spheres are splatted instead
+    if (auto_splat && render_mode < 3 && !views_active && !particles.empty())
+    {
+        float share = impostors.subpixelShare();
+        if (share > ImpostorRenderer::SPLAT_ON_SHARE && impostors.subpixel >= ImpostorRenderer::SPLAT_MIN_IMAGES)
+            auto_splatting = true;
+        else if (share < ImpostorRenderer::SPLAT_OFF_SHARE)
+            auto_splatting = false;
+    }
+    else
+    {
+        auto_splatting = false;
+    }
+    scene_mode = auto_splatting ? 3 : render_mode;
+
+    // the rasters have no per-pixel ray to skip, they always render in full; the
+    // resolve reprojects through a single camera
+    bool checkered = checkerboard != 0 && scene_mode < 2 && !views_active;
+
+    // a pick rides along with a scene draw, so a cached image is drawn again for it;
+    // headless frames are timed and written out, so they always render
+    bool redraw = sceneChanged(frame, scene_w, scene_h, checkered) || picker.pickPending() || headless.enabled;
+    if (redraw)
+    {
+        glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+        picker.begin();
+        governor.beginFrame();
+        if (checkered)
+        {
+            temporal.pattern = checkerboard;
+            temporal.begin(scene_w, scene_h, frame);
+            renderScene(frame, scene_w, scene_h);
+            temporal.resolve();
+        }
+        else
+        {
+            scene_target.bind(scene_w, scene_h);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderScene(frame, scene_w, scene_h);
+            temporal.invalidate();
+        }
+        governor.endFrame();
+    }
+    picker.end(particleSSBO, sizeof(ParticleGPU));
+
+    return checkered ? temporal.output() : scene_target;
+}
+
+SceneSettings Application::sceneSettings(int scene_w, int scene_h) const
+{
+    return {
+        w, h, scene_w, scene_h,
+        scene_mode, checkerboard, governor.max_steps, views_active ? multi_view.preset : 0, scene_mode == 4 ? slice_axis : 0,
+        governor.render_scale, governor.tolerance, lod_pixels, sky_map.star_density, materials.readyMask(),
+        use_tile_culling, use_distance_field, use_bvh, use_cluster_lod,
+        use_march_seed, use_cone_prepass, use_compute_marcher, auto_splat
+    };
+}
+
+// Whether this frame has to render the scene, false while the cached image is current.
+bool Application::sceneChanged(const float frame[16], int scene_w, int scene_h, bool checkered)
+{
+    SceneSettings settings = sceneSettings(scene_w, scene_h);
+    float second_frame[16];
+    second_cam.frame_matrix(second_frame);
+
+    if (!has_cached_scene || particles_changed || settings != cached_settings ||
+        std::memcmp(frame, cached_frame, sizeof(cached_frame)) != 0 ||
+        std::memcmp(second_frame, cached_second_frame, sizeof(cached_second_frame)) != 0)
+    {
+        // a checkerboard needs a few unchanged frames to fill in every pixel, a
+        // full frame is done in one
+        settle_frames = checkered ? SCENE_SETTLE_FRAMES * checkerboard : 1;
+    }
+
+    has_cached_scene = true;
+    particles_changed = false;
+    cached_settings = settings;
+    std::memcpy(cached_frame, frame, sizeof(cached_frame));
+    std::memcpy(cached_second_frame, second_frame, sizeof(cached_second_frame));
+
+    if (settle_frames == 0) return false;
+    settle_frames--;
+    return true;
+}
+
+// Whether the cached image still shows the current camera, particles and settings.
+bool Application::sceneCached(int scene_w, int scene_h) const
+{
+    float frame[16];
+    cam.frame_matrix(frame);
+    float second_frame[16];
+    second_cam.frame_matrix(second_frame);
+
+    return has_cached_scene && !particles_changed && settle_frames == 0 &&
+        sceneSettings(scene_w, scene_h) == cached_settings &&
+        std::memcmp(frame, cached_frame, sizeof(cached_frame)) == 0 &&
+        std::memcmp(second_frame, cached_second_frame, sizeof(cached_second_frame)) == 0;
+}
+
+void Application::renderScene(const float frame[16], int width, int height)
+{
+    // the compute marcher writes the full image, it has no checkerboard pattern;
+    // it, the seed and the cone prepass all march a single camera
+    bool compute_active = scene_mode == 0 && use_compute_marcher && checkerboard == 0 && !views_active;
+    bool field_active = scene_mode == 0 && use_distance_field && !compute_active;
+    bool bvh_active = scene_mode == 0 && use_bvh && !compute_active;
+    bool seed_active = scene_mode == 0 && use_march_seed && !compute_active && !views_active;
+    bool cone_active = scene_mode == 0 && use_cone_prepass && !views_active;
+    bool raster = scene_mode >= 2;
+    int checker = checkerboard != 0 && !raster && !views_active ? checkerboard : 0;
+
+    multi_view.update(views_active, cam, second_cam, width, height);
+    multi_view.bind();
+
+    // the cross-section is seen from the camera moved into the slice hyperplane;
+    // while marching the cull only measures the projected sizes for auto splatting
+    float slice[16] = {};
+    if (scene_mode == 4)
+    {
+        const Vec4 world_axes[4] = { Vec4(0, 0, 0, 1), Vec4(1, 0, 0, 0), Vec4(0, 1, 0, 0), Vec4(0, 0, 1, 0) };
+        Vec4 normal = slice_axis == 0 ? cam.up : world_axes[slice_axis - 1];
+        float n[4] = { normal.x, normal.y, normal.z, normal.w };
+
+        cam.slice_matrix(normal, slice);
+        impostors.cullSlice(particleSSBO, slice, n, normal.dot(cam.pos), width, height);
+    }
+    else if (raster || auto_splat)
+    {
+        impostors.splat = scene_mode == 3;
+        impostors.cull(particleSSBO, frame, width, height);
+    }
+    if (!raster && use_tile_culling)
+        tile_culler.dispatch(particleSSBO, particles.size(), frame, width, height, governor.tolerance);
+
+    if (field_active)
+        distance_field.dispatch(particleSSBO, particles.size());
+
+    if (bvh_active)
+        bvh.update(particleSSBO);
+
+    if (seed_active)
+        march_seed.update(particleSSBO, frame, width, height);
+    else
+        march_seed.invalidate();
+
+    if (cone_active)
+        cone_prepass.dispatch(particleSSBO, frame, width, height, governor.tolerance);
+
+    // straight into the scene target, the only one bound without a checkerboard
+    if (compute_active)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+        tile_culler.bind();
+        picker.bind();
+        cone_prepass.bind(ComputeMarcher::CONE_UNIT);
+        sky_map.bind(ComputeMarcher::SKY_UNIT);
+        materials.bind(ComputeMarcher::MATERIAL_UNIT);
+        compute_marcher.dispatch(scene_target.colorTexture(), frame, width, height, governor.max_steps, governor.tolerance,
+            use_tile_culling ? tile_culler.tilesX() : 0, use_tile_culling ? tile_culler.tilesY() : 0, cone_active,
+            materials.readyMask());
+        return;
+    }
+
+    glUseProgram(shader_program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    tile_culler.bind();
+    distance_field.bind(1);
+    bvh.bind();
+    march_seed.bind();
+    picker.bind();
+    cone_prepass.bind(2);
+    sky_map.bind(3);
+    materials.bind(4);
+    glBindVertexArray(vao);
+
+    if (u_resolution != -1) glUniform2f(u_resolution, float(width), float(height));
+    if (u_camera != -1) glUniformMatrix4fv(u_camera, 1, GL_FALSE, frame);
+    if (u_use_tiles != -1) glUniform1i(u_use_tiles, use_tile_culling && !raster ? 1 : 0);
+    if (u_tiles != -1) glUniform2i(u_tiles, tile_culler.tilesX(), tile_culler.tilesY());
+    if (u_render_mode != -1) glUniform1i(u_render_mode, raster ? 2 : scene_mode);
+    if (u_use_field != -1) glUniform1i(u_use_field, field_active ? 1 : 0);
+    if (u_field != -1) glUniform1i(u_field, 1);
+    if (u_field_cell_radius != -1) glUniform1f(u_field_cell_radius, DistanceField::cellRadius());
+    if (u_max_steps != -1) glUniform1i(u_max_steps, governor.max_steps);
+    if (u_tolerance != -1) glUniform1f(u_tolerance, governor.tolerance);
+    if (u_checker != -1) glUniform1i(u_checker, checker);
+    if (u_frame_index != -1) glUniform1i(u_frame_index, temporal.frameIndex());
+    if (u_use_bvh != -1) glUniform1i(u_use_bvh, bvh_active && !particles.empty() ? 1 : 0);
+    if (u_lod_pixels != -1) glUniform1f(u_lod_pixels, bvh_active && use_cluster_lod ? lod_pixels : 0.0f);
+    if (u_use_seed != -1) glUniform1i(u_use_seed, seed_active ? 1 : 0);
+    if (u_seed_frame != -1) glUniform1i(u_seed_frame, march_seed.frame());
+    if (u_camera_shift != -1) glUniform1f(u_camera_shift, march_seed.cameraShift());
+    if (u_prev_camera != -1) glUniformMatrix4fv(u_prev_camera, 1, GL_FALSE, march_seed.previousCamera());
+    if (u_use_cone != -1) glUniform1i(u_use_cone, cone_active ? 1 : 0);
+    if (u_cone_start != -1) glUniform1i(u_cone_start, 2);
+    if (u_sky != -1) glUniform1i(u_sky, 3);
+    if (u_materials != -1) glUniform1i(u_materials, 4);
+    if (u_material_ready != -1) glUniform1ui(u_material_ready, materials.readyMask());
+
+    if (u_show_arrow != -1) glUniform1i(u_show_arrow, show_velocity_arrow ? 1 : 0);
+
+    if (show_velocity_arrow && particles.size() > 0)
+    {
+        Vec4 arrow_start = particles[0].position;
+        Vec4 arrow_dir = red_ball_velocity_input.normalized();
+        float arrow_len = velocity_magnitude * 0.5f;
+
+        if (u_arrow_start != -1) glUniform4f(u_arrow_start, arrow_start.x, arrow_start.y, arrow_start.z, arrow_start.w);
+        if (u_arrow_direction != -1) glUniform4f(u_arrow_direction, arrow_dir.x, arrow_dir.y, arrow_dir.z, arrow_dir.w);
+        if (u_arrow_length != -1) glUniform1f(u_arrow_length, arrow_len);
+    }
+
+    glDisable(GL_DEPTH_TEST);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (raster)
+        impostors.draw(particleSSBO, scene_mode == 4 ? slice : frame, materials.readyMask());
+}
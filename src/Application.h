@@ -9,6 +9,25 @@
 #include "glad/glad.h"
 #include "glfw3.h"
 #include "Camera.h"
+#include "RewindBuffer.h"
+#include "ClusterFinder.h"
+#include "PairCorrelation.h"
+#include "ConservationMonitor.h"
+#include "TileCuller.h"
+#include "ImpostorRenderer.h"
+#include "DistanceField.h"
+#include "SphereBVH.h"
+#include "MarchSeed.h"
+#include "ConePrepass.h"
+#include "ComputeMarcher.h"
+#include "MultiView.h"
+#include "SkyMap.h"
+#include "MaterialLibrary.h"
+#include "RenderTarget.h"
+#include "FrameRecorder.h"
+#include "SpherePicker.h"
+#include "FrameGovernor.h"
+#include "TemporalReprojection.h"
 
 // ImGui includes
 #include "imgui.h"
@@ -21,12 +40,43 @@ struct ParticleGPU
 	Vec3 color;
 	float radius;
 	Vec4 velocity;
+	int material = -1;   // MaterialLibrary layer, -1 for the flat color
+	int pad[3] = {};     // std430 rounds the struct up to 64 bytes
+};
+
+// Offscreen run without a display: a hidden GLFW window on the null platform with
+// an EGL (surfaceless) or OSMesa context. The driver still has to offer GL 4.6.
+// The scene is rendered at a fixed resolution and time step for a number of frames,
+// every frame in full. Rounds run back to back with the current velocities and the
+// simulation keeps going after the last one.
+struct HeadlessSettings
+{
+	bool enabled = false;
+	int width = 1280;
+	int height = 720;
+	int frames = 120;
+	float dt = 1.0f / 60.0f;
+	std::string output;   // PPM path for the last frame, a printf pattern such as "frame%04d.ppm" for every frame
+	std::string record;   // Y4M path recording every frame through FrameRecorder
+};
+
+// Everything besides the camera and the particles the scene image depends on;
+// while it, the camera and the particles stay the same the last image is reused.
+struct SceneSettings
+{
+	int width, height, scene_width, scene_height;
+	int scene_mode, checkerboard, max_steps, views, slice_axis;
+	float render_scale, tolerance, lod_pixels, star_density;
+	GLuint materials;
+	bool tiles, field, bvh, cluster_lod, seed, cone, compute, auto_splat;
+
+	bool operator==(const SceneSettings&) const = default;
 };
 
 class Application
 {
 public:
-	Application();
+	Application(const HeadlessSettings& headless = {});
 	~Application();
 	static void handle_events(GLFWwindow* window, int key, int scancode, int action, int mods);
 	int run();
@@ -43,6 +93,19 @@ private:
 	void startNewRound();
 	void applyRedBallVelocity();
 	void toggleFullscreen();
+	int runHeadless();
+	const RenderTarget& updateScene(const float frame[16], int scene_w, int scene_h);
+	void renderScene(const float frame[16], int width, int height);
+	SceneSettings sceneSettings(int scene_w, int scene_h) const;
+	bool sceneChanged(const float frame[16], int scene_w, int scene_h, bool checkered);
+	bool sceneCached(int scene_w, int scene_h) const;
+
+	void uploadParticles();
+	void syncParticleMirror();
+	void stepSimulation(float dt);
+	void markRoundStart();
+	void retryRound();
+	void scrubRewind(float seconds_back);
 
 
 	void initAudio();
@@ -50,19 +113,76 @@ private:
 	void stopAudio();
 
 
-	GLuint pos_id;
-	GLuint front_id;
-	GLuint right_id;
-	GLuint up_id;
+	GLuint u_camera;
+	GLuint u_use_tiles;
+	GLuint u_tiles;
+	GLuint u_render_mode;
+	GLuint u_use_field;
+	GLuint u_field;
+	GLuint u_field_cell_radius;
+	GLuint u_use_bvh;
+	GLuint u_lod_pixels;
+	GLuint u_use_seed;
+	GLuint u_seed_frame;
+	GLuint u_camera_shift;
+	GLuint u_prev_camera;
+	GLuint u_use_cone;
+	GLuint u_cone_start;
+	GLuint u_sky;
+	GLuint u_materials;
+	GLuint u_material_ready;
+	GLuint u_max_steps;
+	GLuint u_tolerance;
+	GLuint u_checker;
+	GLuint u_frame_index;
 	GLuint u_resolution;
 	GLuint u_dt;
 	GLuint computeProgram;
 	GLuint particleSSBO;
 	std::vector<ParticleGPU> particles;
+	RewindBuffer rewind;
+	ClusterFinder halo_finder;
+	PairCorrelation pair_correlation;
+	ConservationMonitor conservation;
+	TileCuller tile_culler;
+	ImpostorRenderer impostors;
+	DistanceField distance_field;
+	SphereBVH bvh;
+	MarchSeed march_seed;
+	ConePrepass cone_prepass;
+	ComputeMarcher compute_marcher;
+	MaterialLibrary materials;
+	const char* MATERIAL_DIR = "assets/materials";
+	MultiView multi_view;
+	SkyMap sky_map;
+	RenderTarget scene_target;
+	FrameGovernor governor;
+	TemporalReprojection temporal;
+	float sim_time = 0.0f;
+	float rewind_seconds_back = 0.0f;
+	Camera round_start_cam;
 	GLuint vao;
 	GLFWwindow* window;
 	GLuint shader_program;
 	Camera cam;
+	Camera second_cam;   // player two in the split screen
+	Camera camera_bookmark;
+	Camera camera_flight_start;
+	bool has_camera_bookmark = false;
+	float camera_flight_t = -1.0f;
+	const float CAMERA_FLIGHT_DURATION = 1.0f;
+
+	// render on demand: the last scene image stays in its target until the camera,
+	// the particles or a setting changes, and the loop sleeps while nothing animates
+	bool particles_changed = true;
+	bool has_cached_scene = false;
+	SceneSettings cached_settings = {};
+	float cached_frame[16] = {};
+	float cached_second_frame[16] = {};
+	int settle_frames = 0;
+	const int SCENE_SETTLE_FRAMES = 2;       // a half checkerboard needs two to fill in, a quarter twice that
+	const float IDLE_WAIT = 0.25f;           // longest sleep between idle frames, seconds
+	const float IDLE_FRAME_DT = 1.0f / 60.0f;
 	int w;
 	int h;
 
@@ -75,6 +195,15 @@ private:
 
 	bool ui_mode = false;  
 
+	HeadlessSettings headless;
+
+	FrameRecorder recorder;
+	std::string record_path = "capture.y4m";
+	int record_scale = 0;   // 0 full, 1 half, 2 quarter size
+
+	SpherePicker picker;
+	bool mouse_was_down = false;
+
 
 	bool is_fullscreen = false;
 	int windowed_width = 0;
@@ -125,7 +254,23 @@ private:
 	bool show_velocity_editor = false;
 	float particle_spawn_rate = 1.0f;
 	int max_particles = 128;
+	int body_count = 10;
 	float simulation_speed = 1.0f;
 	bool pause_simulation = false;
 	float clear_color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	bool use_tile_culling = true;
+	bool use_distance_field = false;
+	bool use_bvh = false;
+	bool use_cluster_lod = false;
+	float lod_pixels = 3.0f;   // clusters narrower than this on screen are drawn as one cap
+	bool use_march_seed = false;
+	bool use_cone_prepass = false;
+	bool use_compute_marcher = false;
+	int render_mode = 0;   // 0 sphere tracing, 1 analytic intersection, 2 impostor raster, 3 point splats, 4 cross-section
+	int scene_mode = 0;    // render_mode, or 3 while auto splatting
+	int slice_axis = 0;    // cross-section normal: 0 the camera's up, 1-4 world W, X, Y, Z
+	bool auto_splat = true;
+	bool auto_splatting = false;
+	bool views_active = false;   // a MultiView preset other than a single view, marchers only
+	int checkerboard = 0;  // 0 off, 1 half the pixels per frame, 2 a quarter
 };
\ No newline at end of file
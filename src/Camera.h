@@ -3,61 +3,132 @@
 #include "Vector.h"
 
 
+// Camera pose on S^3 stored as a left/right isoclinic quaternion pair.
+// The frame is the image of the base frame (right, up, front, pos) =
+// (i, j, k, 1) under v -> rot_left * v * rot_right. Any pair of unit
+// quaternions is an exact SO(4) rotation, so the frame cannot drift out of
+// orthonormality; renormalizing the two quaternions after each step is enough.
 struct Camera
 {
-	Camera() {};
+	Camera() { update_frame(); };
 	~Camera() {};
 
 	float speed = 1;
+	Quat rot_left;
+	Quat rot_right;
+
+	// derived from the pair, refreshed by update_frame()
 	Vec4 pos = Vec4(0, 0,0,1);
 	Vec4 front = Vec4(0,0,1,0);
 	Vec4 right = Vec4(1,0,0,0);
 	Vec4 up = Vec4(0,1,0,0);
 
-	void move_forward(float dt)
-	{
-		Vec4 new_p = pos * cos(dt) + front * sin(dt);
-		Vec4 new_front = front * cos(dt)- pos * sin(dt);
+	// rotations in the camera's own planes, each one costs a single sin/cos pair
+	void move_forward(float dt) { rotate_body(plane(Quat(0, 0, 1, 0), dt), false); }
+	void move_right(float dt) { rotate_body(plane(Quat(1, 0, 0, 0), dt), false); }
+	void move_up(float dt) { rotate_body(plane(Quat(0, 1, 0, 0), dt), false); }
 
-		pos = new_p.normalized();
-		front = new_front.normalized();
-	}
+	// front towards right is the (k, i) plane, generated by j
+	void yaw(float dt) { rotate_body(plane(Quat(0, 1, 0, 0), dt), true); }
 
-	void move_right(float dt)
-	{
-		Vec4 new_p = pos * cos(dt) + right * sin(dt);
-		Vec4 new_right = right * cos(dt) - pos * sin(dt);
+	// up towards front is the (j, k) plane, generated by i
+	void pitch(float dt) { rotate_body(plane(Quat(1, 0, 0, 0), dt), true); }
 
-		pos = new_p.normalized();
-		right = new_right.normalized();
+	// Column-major mat4 with columns right, up, front, pos, for a single glUniformMatrix4fv.
+	void frame_matrix(float out[16]) const
+	{
+		const Vec4* cols[4] = { &right, &up, &front, &pos };
+		for (int c = 0; c < 4; c++)
+		{
+			out[c * 4 + 0] = cols[c]->x;
+			out[c * 4 + 1] = cols[c]->y;
+			out[c * 4 + 2] = cols[c]->z;
+			out[c * 4 + 3] = cols[c]->w;
+		}
 	}
 
-	void move_up(float dt)
+	// Frame for a cross-section by the hyperplane through pos with unit normal n:
+	// right, up and front moved into the hyperplane, each falling back to the next
+	// camera vector when it lies along n, and pos itself, as in frame_matrix.
+	void slice_matrix(const Vec4& n, float out[16]) const
 	{
-		Vec4  new_p = pos * cos(dt) + up * sin(dt);
-		Vec4 new_up = up * cos(dt) - pos * sin(dt);
-
-		pos = new_p.normalized();
-		up = new_up.normalized();
+		const Vec4 order[3][4] = {
+			{ front, up, right, pos },
+			{ up, pos, front, right },
+			{ right, pos, up, front } };
+
+		// the four camera vectors span R^4, so one always has a quarter left
+		Vec4 axes[3];
+		for (int a = 0; a < 3; a++)
+		{
+			for (const Vec4& v : order[a])
+			{
+				Vec4 u = v - n * n.dot(v);
+				for (int b = 0; b < a; b++)
+					u = u - axes[b] * axes[b].dot(u);
+				if (u.length2() > 0.01f)
+				{
+					axes[a] = u.normalized();
+					break;
+				}
+			}
+		}
+
+		const Vec4* cols[4] = { &axes[2], &axes[1], &axes[0], &pos };
+		for (int c = 0; c < 4; c++)
+		{
+			out[c * 4 + 0] = cols[c]->x;
+			out[c * 4 + 1] = cols[c]->y;
+			out[c * 4 + 2] = cols[c]->z;
+			out[c * 4 + 3] = cols[c]->w;
+		}
 	}
 
-	void yaw(float dt)
+	// Shortest SO(4) path between two poses, both halves slerped together.
+	static Camera interpolate(const Camera& a, const Camera& b, float t)
 	{
-		Vec4 new_front = front * cos(dt) + right * sin(dt);
-		Vec4 new_right = right * cos(dt) - front * sin(dt);
-
-		front = new_front.normalized();
-		right = new_right.normalized();
+		Quat bl = b.rot_left;
+		Quat br = b.rot_right;
+
+		// (l, r) and (-l, -r) are the same rotation
+		if (a.rot_left.dot(bl) + a.rot_right.dot(br) < 0.0f)
+		{
+			bl = -bl;
+			br = -br;
+		}
+
+		Camera out = a;
+		out.rot_left = Quat::slerp(a.rot_left, bl, t);
+		out.rot_right = Quat::slerp(a.rot_right, br, t);
+		out.update_frame();
+		return out;
 	}
 
-	void pitch(float dt)
+	void update_frame()
 	{
-		Vec4 new_up = up * cos(dt) + front  * sin(dt);
-		Vec4 new_front = front  * cos(dt) - up * sin(dt);
+		pos = (rot_left * rot_right).vec();
+		right = (rot_left * Quat(1, 0, 0, 0) * rot_right).vec();
+		up = (rot_left * Quat(0, 1, 0, 0) * rot_right).vec();
+		front = (rot_left * Quat(0, 0, 1, 0) * rot_right).vec();
+	}
 
-		front = new_front.normalized();
-		up = new_up.normalized();
+private:
+	// exp(axis * dt / 2) for a unit imaginary axis
+	static Quat plane(const Quat& axis, float dt)
+	{
+		float s = std::sin(0.5f * dt);
+		float c = std::cos(0.5f * dt);
+		return Quat(axis.x * s, axis.y * s, axis.z * s, c);
 	}
 
+	// Composes a rotation given in camera coordinates. Moves rotate the pos
+	// plane and use (q, q); turns keep pos fixed and use (q, q^-1).
+	void rotate_body(const Quat& q, bool turn)
+	{
+		Quat r = turn ? Quat(-q.x, -q.y, -q.z, q.w) : q;
 
-};
\ No newline at end of file
+		rot_left = (rot_left * q).normalized();
+		rot_right = (r * rot_right).normalized();
+		update_frame();
+	}
+};
@@ -0,0 +1,141 @@
+#include "ClusterFinder.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const GLuint WORKGROUP = 64;
+static const size_t ACCUM_BYTES = 32;
+static const size_t MASS_BINS = 256;
+static const size_t SUMMARY_HEADER_BYTES = 32 + MASS_BINS * sizeof(GLuint);
+static const int STAGES = 7;
+
+// The sums are 32 bit atomics, so masses and mass weighted positions go in as
+// fixed point. The smallest body gets SMALLEST_UNITS units unless the whole
+// population would then pass MAX_UNITS; every sum, signed center components
+// included, stays below the total, which leaves a factor two of headroom.
+static const float SMALLEST_UNITS = 1048576.0f;
+static const float MAX_UNITS = 1073741824.0f;
+
+void ClusterFinder::release()
+{
+    if (fence) glDeleteSync(fence);
+    if (program) glDeleteProgram(program);
+    if (parentSSBO) glDeleteBuffers(1, &parentSSBO);
+    if (gridSSBO) glDeleteBuffers(1, &gridSSBO);
+    if (accumSSBO) glDeleteBuffers(1, &accumSSBO);
+    if (summarySSBO) glDeleteBuffers(1, &summarySSBO);
+    fence = nullptr;
+    program = parentSSBO = gridSSBO = accumSSBO = summarySSBO = 0;
+}
+
+void ClusterFinder::init()
+{
+    program = LoadComputeProgram("halo_finder.glsl");
+    u_stage = glGetUniformLocation(program, "stage");
+    u_link_cos = glGetUniformLocation(program, "link_cos");
+    u_min_members = glGetUniformLocation(program, "min_members");
+    u_cell_size = glGetUniformLocation(program, "cell_size");
+    u_table_mask = glGetUniformLocation(program, "table_mask");
+    u_mass_fx = glGetUniformLocation(program, "mass_fx");
+
+    glGenBuffers(1, &parentSSBO);
+    glGenBuffers(1, &gridSSBO);
+    glGenBuffers(1, &accumSSBO);
+    glGenBuffers(1, &summarySSBO);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, summarySSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, SUMMARY_HEADER_BYTES + MAX_REPORTED * sizeof(Cluster), nullptr, GL_DYNAMIC_READ);
+}
+
+void ClusterFinder::allocate(size_t particle_count, float smallest_mass, float total_mass)
+{
+    this->particle_count = particle_count;
+
+    mass_fx = total_mass > 0.0f ? MAX_UNITS / total_mass : 1.0f;
+    if (smallest_mass > 0.0f)
+        mass_fx = std::min(mass_fx, SMALLEST_UNITS / smallest_mass);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, parentSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, particle_count) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, particle_count) * ACCUM_BYTES, nullptr, GL_DYNAMIC_COPY);
+
+    // about half the buckets stay empty, so a walk of the 81 neighbour cells
+    // mostly meets real neighbours
+    table_size = 1;
+    while (table_size < 2 * particle_count) table_size *= 2;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (table_size + std::max<size_t>(1, particle_count)) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    cluster_count = 0;
+    grouped_particles = 0;
+    grouped_mass = 0.0f;
+    clusters.clear();
+}
+
+void ClusterFinder::dispatch(GLuint particleSSBO)
+{
+    if (particle_count < 2) return;
+
+    // linking length as a fraction of the mean spacing, volume of S^3 is 2 pi^2
+    const float PI = 3.14159265359f;
+    float spacing = std::cbrt(2.0f * PI * PI / float(particle_count));
+    linking_length = linking_factor * spacing;
+
+    glUseProgram(program);
+    glUniform1f(u_link_cos, std::cos(linking_length));
+    glUniform1ui(u_min_members, GLuint(std::max(1, min_members)));
+    glUniform1f(u_cell_size, std::max(2.0f * std::sin(0.5f * linking_length), 1e-4f));
+    glUniform1ui(u_table_mask, GLuint(table_size - 1));
+    glUniform1f(u_mass_fx, mass_fx);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, parentSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, accumSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, summarySSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, gridSSBO);
+
+    // the reset also clears the hash table and the mass histogram, which can be
+    // larger than the body count; the bin selection is a single invocation
+    GLuint groups = GLuint((particle_count + WORKGROUP - 1) / WORKGROUP);
+    GLuint reset_groups = GLuint((std::max({ table_size, particle_count, MASS_BINS }) + WORKGROUP - 1) / WORKGROUP);
+    for (int stage = 0; stage < STAGES; stage++)
+    {
+        glUniform1i(u_stage, stage);
+        glDispatchCompute(stage == 0 ? reset_groups : stage == 5 ? 1 : groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void ClusterFinder::poll()
+{
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    GLuint header[4];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, summarySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+
+    cluster_count = header[0];
+    grouped_particles = header[1];
+    grouped_mass = float(header[2]) / mass_fx;
+
+    clusters.resize(std::min<GLuint>(header[3], MAX_REPORTED));
+    if (!clusters.empty())
+    {
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, SUMMARY_HEADER_BYTES, clusters.size() * sizeof(Cluster), clusters.data());
+    }
+
+    std::sort(clusters.begin(), clusters.end(),
+        [](const Cluster& a, const Cluster& b) { return a.mass > b.mass; });
+}
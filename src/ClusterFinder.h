@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "glad/glad.h"
+#include "Vector.h"
+
+// Friends-of-friends halo finder on S^3. Bodies are binned into a hashed grid of
+// R^4 cells one linking chord wide; bodies in neighbouring cells closer than the
+// linking length are joined with a lock-free union-find on the GPU, the labelled
+// groups are then reduced to counts, masses and centers. Only the small summary
+// is read back, one frame later through a fence.
+class ClusterFinder
+{
+public:
+	struct Cluster
+	{
+		Vec4 center;
+		float mass;
+		GLuint count;
+		GLuint root;
+		GLuint pad;
+	};
+
+	ClusterFinder() {};
+	~ClusterFinder() {};
+
+	void init();
+	void release();
+	// The body masses set the fixed point the sums are taken in, see mass_fx.
+	void allocate(size_t particle_count, float smallest_mass, float total_mass);
+
+	void dispatch(GLuint particleSSBO);
+
+	// Picks up the result of the last dispatch once the GPU is done with it.
+	void poll();
+
+	float linking_factor = 0.2f;   // fraction of the mean inter-particle spacing
+	int min_members = 2;
+
+	float linking_length = 0.0f;
+	GLuint cluster_count = 0;
+	GLuint grouped_particles = 0;
+	float grouped_mass = 0.0f;
+	// Heaviest first. With more than MAX_REPORTED groups the list is cut at a mass
+	// bin boundary (eight per octave), so it holds the heaviest groups but can hold
+	// fewer than MAX_REPORTED.
+	std::vector<Cluster> clusters;
+
+	static const int MAX_REPORTED = 1024;
+
+private:
+	GLuint program = 0;
+	GLuint u_stage = 0;
+	GLuint u_link_cos = 0;
+	GLuint u_min_members = 0;
+	GLuint u_cell_size = 0;
+	GLuint u_table_mask = 0;
+	GLuint u_mass_fx = 0;
+
+	GLuint parentSSBO = 0;
+	GLuint gridSSBO = 0;
+	GLuint accumSSBO = 0;
+	GLuint summarySSBO = 0;
+
+	size_t particle_count = 0;
+	size_t table_size = 0;   // hash buckets, a power of two of at least twice the bodies
+	float mass_fx = 0.0f;    // fixed point units per unit of mass
+	GLsync fence = nullptr;
+};
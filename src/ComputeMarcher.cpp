@@ -0,0 +1,82 @@
+#include "ComputeMarcher.h"
+#include "Shader.h"
+
+#include <cstring>
+#include <string>
+
+// GL_KHR_shader_subgroup queries, not in the loader
+#ifndef GL_SUBGROUP_SUPPORTED_STAGES_KHR
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR 0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+#define GL_SUBGROUP_FEATURE_BASIC_BIT_KHR 0x00000001
+#define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR 0x00000004
+#endif
+
+static bool HasSubgroupArithmetic()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    bool found = false;
+    for (GLint i = 0; i < count && !found; i++)
+        found = std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), "GL_KHR_shader_subgroup") == 0;
+    if (!found) return false;
+
+    GLint stages = 0, features = 0;
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+
+    const GLint needed = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR;
+    return (stages & GL_COMPUTE_SHADER_BIT) && (features & needed) == needed;
+}
+
+void ComputeMarcher::release()
+{
+    if (program) glDeleteProgram(program);
+    program = 0;
+}
+
+void ComputeMarcher::init()
+{
+    use_subgroups = HasSubgroupArithmetic();
+
+    // the define goes right after the #version line
+    std::string src = ReadFile("shaders/march_compute.glsl");
+    if (use_subgroups)
+        src.insert(src.find('\n') + 1, "#define USE_SUBGROUPS\n");
+
+    GLuint cs = CompileShader(GL_COMPUTE_SHADER, src, "march_compute.glsl");
+    program = LinkComputeProgram(cs, "march_compute.glsl");
+
+    u_camera = glGetUniformLocation(program, "u_camera");
+    u_resolution = glGetUniformLocation(program, "u_resolution");
+    u_max_steps = glGetUniformLocation(program, "u_max_steps");
+    u_tolerance = glGetUniformLocation(program, "u_tolerance");
+    u_tiles = glGetUniformLocation(program, "u_tiles");
+    u_use_cone = glGetUniformLocation(program, "u_use_cone");
+    u_material_ready = glGetUniformLocation(program, "u_material_ready");
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "u_cone_start"), CONE_UNIT);
+    glUniform1i(glGetUniformLocation(program, "u_sky"), SKY_UNIT);
+    glUniform1i(glGetUniformLocation(program, "u_materials"), MATERIAL_UNIT);
+    glUseProgram(0);
+}
+
+void ComputeMarcher::dispatch(GLuint target, const float camera[16], int width, int height,
+    int max_steps, float tolerance, int tiles_x, int tiles_y, bool use_cone, GLuint material_ready)
+{
+    glUseProgram(program);
+    glUniformMatrix4fv(u_camera, 1, GL_FALSE, camera);
+    glUniform2f(u_resolution, float(width), float(height));
+    glUniform1i(u_max_steps, max_steps);
+    glUniform1f(u_tolerance, tolerance);
+    glUniform2i(u_tiles, tiles_x, tiles_y);
+    glUniform1i(u_use_cone, use_cone ? 1 : 0);
+    glUniform1ui(u_material_ready, material_ready);
+
+    glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    glDispatchCompute(GLuint((width + BLOCK - 1) / BLOCK), GLuint((height + BLOCK - 1) / BLOCK), 1);
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "glad/glad.h"
+
+// Compute shader version of frag.glsl's sphere tracing. Each 8x8 workgroup
+// streams its candidate spheres through shared memory once, keeps only the ones
+// some ray of the block can hit, and then marches every pixel against that short
+// shared list instead of reloading spheres from the buffer at every step. Uses
+// subgroup operations to merge the per-ray masks where the driver supports them.
+class ComputeMarcher
+{
+public:
+	ComputeMarcher() {};
+	~ComputeMarcher() {};
+
+	void init();
+	void release();
+
+	// Marches width x height pixels into the lower left of target, an RGBA16F
+	// texture such as RenderTarget::colorTexture. Expects the particles, tile lists
+	// (when tiles_x > 0), cone start, sky map and materials bound where frag.glsl
+	// reads them; material_ready is MaterialLibrary::readyMask.
+	void dispatch(GLuint target, const float camera[16], int width, int height,
+		int max_steps, float tolerance, int tiles_x, int tiles_y, bool use_cone, GLuint material_ready);
+
+	bool subgroups() const { return use_subgroups; }
+
+	static const int BLOCK = 8;
+	static const GLuint CONE_UNIT = 2;
+	static const GLuint SKY_UNIT = 3;
+	static const GLuint MATERIAL_UNIT = 4;
+
+private:
+	GLuint program = 0;
+	GLuint u_camera = 0;
+	GLuint u_resolution = 0;
+	GLuint u_max_steps = 0;
+	GLuint u_tolerance = 0;
+	GLuint u_tiles = 0;
+	GLuint u_use_cone = 0;
+	GLuint u_material_ready = 0;
+
+	bool use_subgroups = false;
+};
@@ -0,0 +1,61 @@
+#include "ConePrepass.h"
+#include "Shader.h"
+
+static const GLuint WORKGROUP = 8;
+
+void ConePrepass::release()
+{
+    if (program) glDeleteProgram(program);
+    if (startTexture) glDeleteTextures(1, &startTexture);
+    program = startTexture = 0;
+}
+
+void ConePrepass::init()
+{
+    program = LoadComputeProgram("cone_prepass.glsl");
+    u_camera = glGetUniformLocation(program, "u_camera");
+    u_resolution = glGetUniformLocation(program, "u_resolution");
+    u_tolerance = glGetUniformLocation(program, "u_tolerance");
+}
+
+void ConePrepass::resize(int width, int height)
+{
+    int cells_x = (width + CONE_TILE - 1) / CONE_TILE;
+    int cells_y = (height + CONE_TILE - 1) / CONE_TILE;
+    if (cells_x == this->width && cells_y == this->height) return;
+
+    this->width = cells_x;
+    this->height = cells_y;
+
+    if (startTexture) glDeleteTextures(1, &startTexture);
+    glGenTextures(1, &startTexture);
+    glBindTexture(GL_TEXTURE_2D, startTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, cells_x, cells_y);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ConePrepass::dispatch(GLuint particleSSBO, const float camera[16], int width, int height, float tolerance)
+{
+    GLuint cells_x = GLuint((width + CONE_TILE - 1) / CONE_TILE);
+    GLuint cells_y = GLuint((height + CONE_TILE - 1) / CONE_TILE);
+
+    glUseProgram(program);
+    glUniformMatrix4fv(u_camera, 1, GL_FALSE, camera);
+    glUniform2f(u_resolution, float(width), float(height));
+    glUniform1f(u_tolerance, tolerance);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindImageTexture(0, startTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+    glDispatchCompute((cells_x + WORKGROUP - 1) / WORKGROUP, (cells_y + WORKGROUP - 1) / WORKGROUP, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void ConePrepass::bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, startTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
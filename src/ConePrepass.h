@@ -0,0 +1,38 @@
+#pragma once
+#include "glad/glad.h"
+
+// Hierarchical sphere tracing: a compute pass cone-marches one bundle of
+// CONE_TILE x CONE_TILE rays per texel of a 1/8 resolution R32F texture and
+// stores the distance every ray of the bundle can skip. frag.glsl starts its
+// march there instead of at the camera. Needs no history, unlike MarchSeed.
+class ConePrepass
+{
+public:
+	ConePrepass() {};
+	~ConePrepass() {};
+
+	void init();
+	void release();
+
+	// Storage follows the window, like the scene target.
+	void resize(int width, int height);
+
+	// camera is the column-major frame from Camera::frame_matrix, width x height
+	// the full resolution scene size and tolerance the marcher's hit threshold.
+	void dispatch(GLuint particleSSBO, const float camera[16], int width, int height, float tolerance);
+
+	// Binds the start distances as a sampler2D on the given texture unit.
+	void bind(GLuint unit) const;
+
+	static const int CONE_TILE = 8;
+
+private:
+	GLuint program = 0;
+	GLuint u_camera = 0;
+	GLuint u_resolution = 0;
+	GLuint u_tolerance = 0;
+
+	GLuint startTexture = 0;
+	int width = 0;
+	int height = 0;
+};
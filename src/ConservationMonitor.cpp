@@ -0,0 +1,144 @@
+#include "ConservationMonitor.h"
+#include "Shader.h"
+
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+static const GLuint WORKGROUP = 256;
+static const int QUANTITIES = 8;
+
+static float MomentumNorm(const float* l)
+{
+    float s = 0.0f;
+    for (int i = 0; i < 6; i++) s += l[i] * l[i];
+    return std::sqrt(s);
+}
+
+void ConservationMonitor::release()
+{
+    if (fence) glDeleteSync(fence);
+    if (program) glDeleteProgram(program);
+    if (partialSSBO) glDeleteBuffers(1, &partialSSBO);
+    if (resultSSBO) glDeleteBuffers(1, &resultSSBO);
+    fence = nullptr;
+    program = partialSSBO = resultSSBO = 0;
+}
+
+void ConservationMonitor::init()
+{
+    program = LoadComputeProgram("conserved.glsl");
+    u_stage = glGetUniformLocation(program, "stage");
+    u_partial_count = glGetUniformLocation(program, "partial_count");
+
+    glGenBuffers(1, &partialSSBO);
+    glGenBuffers(1, &resultSSBO);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, resultSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, QUANTITIES * sizeof(float), nullptr, GL_DYNAMIC_READ);
+}
+
+void ConservationMonitor::allocate(size_t particle_count)
+{
+    this->particle_count = particle_count;
+    group_count = GLuint(std::max<size_t>(1, (particle_count + WORKGROUP - 1) / WORKGROUP));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, partialSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, group_count * QUANTITIES * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+
+    samples.clear();
+    energy_drift.clear();
+    momentum_drift.clear();
+    last_time = -1.0f;
+}
+
+void ConservationMonitor::tick(GLuint particleSSBO, float sim_time)
+{
+    if (particle_count == 0 || fence) return;
+
+    // a rewind starts a new timeline, drift is measured from there
+    if (sim_time < last_time)
+    {
+        samples.clear();
+        energy_drift.clear();
+        momentum_drift.clear();
+        last_time = -1.0f;
+    }
+
+    if (last_time >= 0.0f && sim_time - last_time < interval) return;
+    last_time = sim_time;
+
+    glUseProgram(program);
+    glUniform1ui(u_partial_count, group_count);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, partialSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, resultSSBO);
+
+    glUniform1i(u_stage, 0);
+    glDispatchCompute(group_count, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUniform1i(u_stage, 1);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence_time = sim_time;
+}
+
+void ConservationMonitor::poll()
+{
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    float result[QUANTITIES];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, resultSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(result), result);
+
+    Sample s;
+    s.time = fence_time;
+    s.kinetic = result[0];
+    s.potential = result[1];
+    for (int i = 0; i < 6; i++) s.momentum[i] = result[2 + i];
+
+    if (!samples.empty() && s.time < samples.back().time) return;   // stale, timeline was rewound
+    samples.push_back(s);
+
+    const Sample& ref = samples.front();
+    float e0 = ref.kinetic + ref.potential;
+    float e = s.kinetic + s.potential;
+
+    float dl[6];
+    for (int i = 0; i < 6; i++) dl[i] = s.momentum[i] - ref.momentum[i];
+    float l0 = MomentumNorm(ref.momentum);
+
+    energy_drift.push_back(e0 != 0.0f ? (e - e0) / std::abs(e0) : 0.0f);
+    momentum_drift.push_back(l0 != 0.0f ? MomentumNorm(dl) / l0 : 0.0f);
+
+    if (energy_drift.size() > HISTORY)
+    {
+        energy_drift.erase(energy_drift.begin());
+        momentum_drift.erase(momentum_drift.begin());
+    }
+}
+
+bool ConservationMonitor::exportCSV(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    out << "sim_time,kinetic,potential,total,L_xy,L_xz,L_xw,L_yz,L_yw,L_zw\n";
+    for (const Sample& s : samples)
+    {
+        out << s.time << "," << s.kinetic << "," << s.potential << "," << (s.kinetic + s.potential);
+        for (int i = 0; i < 6; i++) out << "," << s.momentum[i];
+        out << "\n";
+    }
+    return true;
+}
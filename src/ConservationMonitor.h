@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "glad/glad.h"
+
+// Total kinetic and potential energy and the so(4) angular momentum bivector
+// L = sum m (p ^ v), reduced on the GPU at a fixed simulation-time cadence.
+// Drift is measured against the first sample of the current timeline.
+class ConservationMonitor
+{
+public:
+	struct Sample
+	{
+		float time;
+		float kinetic;
+		float potential;
+		float momentum[6];   // xy, xz, xw, yz, yw, zw
+	};
+
+	ConservationMonitor() {};
+	~ConservationMonitor() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count);
+
+	// Dispatches a reduction once `interval` of simulation time passed.
+	void tick(GLuint particleSSBO, float sim_time);
+	void poll();
+
+	bool exportCSV(const std::string& path) const;
+
+	float interval = 0.25f;
+
+	std::vector<Sample> samples;
+	std::vector<float> energy_drift;     // (E - E0) / |E0|
+	std::vector<float> momentum_drift;   // |L - L0| / |L0|
+
+	static const int HISTORY = 600;
+
+private:
+	GLuint program = 0;
+	GLuint u_stage = 0;
+	GLuint u_partial_count = 0;
+
+	GLuint partialSSBO = 0;
+	GLuint resultSSBO = 0;
+
+	size_t particle_count = 0;
+	GLuint group_count = 0;
+
+	GLsync fence = nullptr;
+	float fence_time = 0.0f;
+	float last_time = -1.0f;
+};
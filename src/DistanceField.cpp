@@ -0,0 +1,112 @@
+#include "DistanceField.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const GLuint WORKGROUP = 64;
+static const size_t CELLS = size_t(DistanceField::SIZE_XI) * DistanceField::SIZE_XI * DistanceField::SIZE_ETA;
+
+void DistanceField::release()
+{
+    if (program) glDeleteProgram(program);
+    if (seedSSBO) glDeleteBuffers(1, &seedSSBO);
+    if (floodSSBO[0]) glDeleteBuffers(2, floodSSBO);
+    if (fieldTexture) glDeleteTextures(1, &fieldTexture);
+    program = seedSSBO = fieldTexture = 0;
+    floodSSBO[0] = floodSSBO[1] = 0;
+}
+
+float DistanceField::cellRadius()
+{
+    const float PI = 3.14159265359f;
+    float d_eta = 0.5f * PI / SIZE_ETA;
+    float d_xi = 2.0f * PI / SIZE_XI;
+    return 0.5f * std::sqrt(d_eta * d_eta + d_xi * d_xi);
+}
+
+void DistanceField::init()
+{
+    program = LoadComputeProgram("distance_field.glsl");
+    u_stage = glGetUniformLocation(program, "stage");
+    u_jump = glGetUniformLocation(program, "jump");
+    u_dims = glGetUniformLocation(program, "dims");
+
+    glGenBuffers(1, &seedSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, seedSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CELLS * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(2, floodSSBO);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, floodSSBO[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, CELLS * sizeof(GLint), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    glGenTextures(1, &fieldTexture);
+    glBindTexture(GL_TEXTURE_3D, fieldTexture);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RG32F, SIZE_XI, SIZE_XI, SIZE_ETA);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void DistanceField::dispatch(GLuint particleSSBO, size_t particle_count)
+{
+    glUseProgram(program);
+    glUniform3i(u_dims, SIZE_XI, SIZE_XI, SIZE_ETA);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, seedSSBO);
+    glBindImageTexture(0, fieldTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RG32F);
+
+    GLuint cell_groups = GLuint((CELLS + WORKGROUP - 1) / WORKGROUP);
+    GLuint sphere_groups = GLuint((particle_count + WORKGROUP - 1) / WORKGROUP);
+
+    glUniform1i(u_stage, 0);
+    glDispatchCompute(cell_groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (sphere_groups > 0)
+    {
+        glUniform1i(u_stage, 1);
+        glDispatchCompute(sphere_groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    int src = 0;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, floodSSBO[src]);
+    glUniform1i(u_stage, 2);
+    glDispatchCompute(cell_groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // halving jumps, then a short second sweep: the angles degenerate at both ends
+    // of eta, where plain JFA occasionally keeps a seed that is not the nearest
+    std::vector<int> jumps;
+    for (int jump = std::max(SIZE_XI, SIZE_ETA) / 2; jump >= 1; jump /= 2) jumps.push_back(jump);
+    for (int jump = 4; jump >= 1; jump /= 2) jumps.push_back(jump);
+
+    glUniform1i(u_stage, 3);
+    for (int jump : jumps)
+    {
+        glUniform1i(u_jump, jump);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, floodSSBO[src]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, floodSSBO[1 - src]);
+        glDispatchCompute(cell_groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        src = 1 - src;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, floodSSBO[src]);
+    glUniform1i(u_stage, 4);
+    glDispatchCompute(cell_groups, 1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void DistanceField::bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, fieldTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
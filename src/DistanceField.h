@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include "glad/glad.h"
+
+// Low resolution distance field over S^3, stored in a 3D texture indexed by Hopf
+// coordinates (xi1, xi2, eta). Spheres are binned into their cells and a jump
+// flood finds the nearest occupied cell everywhere, giving per cell the distance
+// to the nearest surface at the cell center and the sphere it belongs to. The
+// marcher subtracts CELL_RADIUS to get a bound valid anywhere in the cell and only
+// evaluates the spheres exactly once that bound gets small.
+class DistanceField
+{
+public:
+	DistanceField() {};
+	~DistanceField() {};
+
+	void init();
+	void release();
+
+	void dispatch(GLuint particleSSBO, size_t particle_count);
+
+	// Binds the field as a sampler3D on the given texture unit.
+	void bind(GLuint unit) const;
+
+	static const int SIZE_XI = 64;    // cells along each Hopf angle
+	static const int SIZE_ETA = 32;   // cells along eta in [0, pi/2]
+
+	// Upper bound on the distance from any point of a cell to its center:
+	// ds^2 = deta^2 + cos^2(eta) dxi1^2 + sin^2(eta) dxi2^2.
+	static float cellRadius();
+
+private:
+	GLuint program = 0;
+	GLuint u_stage = 0;
+	GLuint u_jump = 0;
+	GLuint u_dims = 0;
+
+	GLuint seedSSBO = 0;
+	GLuint floodSSBO[2] = { 0, 0 };
+	GLuint fieldTexture = 0;
+};
@@ -0,0 +1,90 @@
+#include "FrameGovernor.h"
+
+#include <algorithm>
+
+void FrameGovernor::release()
+{
+    if (queries[0]) glDeleteQueries(QUERY_RING, queries);
+    for (GLuint& query : queries) query = 0;
+}
+
+void FrameGovernor::init()
+{
+    glGenQueries(QUERY_RING, queries);
+}
+
+void FrameGovernor::beginFrame()
+{
+    // every query still in flight: skip timing this frame rather than wait
+    active = !pending[head];
+    if (active) glBeginQuery(GL_TIME_ELAPSED, queries[head]);
+}
+
+void FrameGovernor::endFrame()
+{
+    if (!active) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[head] = true;
+    head = (head + 1) % QUERY_RING;
+    active = false;
+}
+
+void FrameGovernor::update()
+{
+    bool measured = false;
+
+    for (int i = 0; i < QUERY_RING; i++)
+    {
+        if (!pending[i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+        pending[i] = false;
+
+        float ms = float(ns) * 1e-6f;
+        gpu_ms = gpu_ms > 0.0f ? gpu_ms + 0.2f * (ms - gpu_ms) : ms;
+        measured = true;
+    }
+
+    if (!enabled || !measured) return;
+    if (++frames_since_change < SETTLE_FRAMES) return;
+
+    // a band around the target keeps the settings from oscillating
+    if (gpu_ms > target_ms * 1.05f)
+        degrade();
+    else if (gpu_ms < target_ms * 0.75f)
+        improve();
+}
+
+void FrameGovernor::degrade()
+{
+    if (render_scale > MIN_SCALE)
+        render_scale = std::max(MIN_SCALE, render_scale * 0.9f);
+    else if (max_steps > MIN_STEPS)
+        max_steps = std::max(MIN_STEPS, max_steps - 2);
+    else if (tolerance < MAX_TOLERANCE)
+        tolerance = std::min(MAX_TOLERANCE, tolerance + 0.005f);
+    else
+        return;
+
+    frames_since_change = 0;
+}
+
+void FrameGovernor::improve()
+{
+    if (tolerance > MIN_TOLERANCE)
+        tolerance = std::max(MIN_TOLERANCE, tolerance - 0.005f);
+    else if (max_steps < MAX_STEPS)
+        max_steps = std::min(MAX_STEPS, max_steps + 2);
+    else if (render_scale < MAX_SCALE)
+        render_scale = std::min(MAX_SCALE, render_scale / 0.9f);
+    else
+        return;
+
+    frames_since_change = 0;
+}
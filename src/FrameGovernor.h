@@ -0,0 +1,54 @@
+#pragma once
+#include "glad/glad.h"
+
+// Holds the scene's GPU time near a budget by trading quality. GPU time comes from
+// GL_TIME_ELAPSED queries in a small ring, read whenever they become available,
+// so measuring never stalls the pipeline. Over budget the render scale drops
+// first, then the march step count, then the hit tolerance grows; under budget
+// the same knobs are restored in reverse order.
+class FrameGovernor
+{
+public:
+	FrameGovernor() {};
+	~FrameGovernor() {};
+
+	void init();
+	void release();
+
+	// Bracket the GPU work being budgeted.
+	void beginFrame();
+	void endFrame();
+
+	// Collects finished timings and adjusts the quality settings.
+	void update();
+
+	bool enabled = true;
+	float target_ms = 14.0f;
+
+	float render_scale = 1.0f;
+	int max_steps = 20;
+	float tolerance = 0.01f;
+
+	float gpu_ms = 0.0f;   // smoothed scene time
+
+	static constexpr float MIN_SCALE = 0.35f;
+	static constexpr float MAX_SCALE = 1.0f;
+	static constexpr int MIN_STEPS = 8;
+	static constexpr int MAX_STEPS = 20;
+	static constexpr float MIN_TOLERANCE = 0.01f;
+	static constexpr float MAX_TOLERANCE = 0.03f;
+
+private:
+	void degrade();
+	void improve();
+
+	static const int QUERY_RING = 4;
+	static const int SETTLE_FRAMES = 8;   // frames between adjustments
+
+	GLuint queries[QUERY_RING] = {};
+	bool pending[QUERY_RING] = {};
+	int head = 0;
+	bool active = false;
+
+	int frames_since_change = 0;
+};
@@ -0,0 +1,268 @@
+#include "FrameRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// full range BT.601, as the C420jpeg tag says
+static void RGBAToI420(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& yuv)
+{
+    int chroma_w = width / 2;
+    int chroma_h = height / 2;
+    yuv.resize(size_t(width) * height + 2 * size_t(chroma_w) * chroma_h);
+
+    unsigned char* y_plane = yuv.data();
+    unsigned char* u_plane = y_plane + size_t(width) * height;
+    unsigned char* v_plane = u_plane + size_t(chroma_w) * chroma_h;
+
+    auto clamp8 = [](float v) { return (unsigned char)std::clamp(int(v + 0.5f), 0, 255); };
+
+    // GL rows start at the bottom, Y4M rows at the top
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* row = rgba + size_t(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char* p = row + x * 4;
+            y_plane[size_t(y) * width + x] = clamp8(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+        }
+    }
+
+    for (int y = 0; y < chroma_h; y++)
+    {
+        const unsigned char* top = rgba + size_t(height - 1 - 2 * y) * width * 4;
+        const unsigned char* bottom = top - size_t(width) * 4;
+        for (int x = 0; x < chroma_w; x++)
+        {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (const unsigned char* p : { top + x * 8, top + x * 8 + 4, bottom + x * 8, bottom + x * 8 + 4 })
+            {
+                r += p[0];
+                g += p[1];
+                b += p[2];
+            }
+            r *= 0.25f; g *= 0.25f; b *= 0.25f;
+
+            u_plane[size_t(y) * chroma_w + x] = clamp8(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            v_plane[size_t(y) * chroma_w + x] = clamp8(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    // release() normally stopped the recording with the context still current,
+    // all that can be left is a writer to wind down
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishing = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+}
+
+void FrameRecorder::release()
+{
+    if (active) stop();
+    releaseTargets();
+}
+
+void FrameRecorder::releaseTargets()
+{
+    for (Slot& slot : slots)
+    {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.pbo) glDeleteBuffers(1, &slot.pbo);
+        slot = Slot();
+    }
+    if (fbo) glDeleteFramebuffers(1, &fbo);
+    if (color) glDeleteTextures(1, &color);
+    fbo = 0;
+    color = 0;
+}
+
+void FrameRecorder::start(const std::string& path, int width, int height, int fps)
+{
+    if (active) stop();
+
+    // 4:2:0 chroma wants even sizes
+    int divisor = std::max(1, scale_divisor);
+    frame_width = std::max(2, (width / divisor) & ~1);
+    frame_height = std::max(2, (height / divisor) & ~1);
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Could not open " + path + " for recording");
+
+    file << "YUV4MPEG2 W" << frame_width << " H" << frame_height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+
+    releaseTargets();
+
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, frame_width, frame_height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        throw std::runtime_error("Recording target is incomplete");
+
+    GLsizeiptr bytes = GLsizeiptr(frame_width) * frame_height * 4;
+    for (Slot& slot : slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    head = 0;
+    tail = 0;
+    captured = 0;
+    written = 0;
+    dropped = 0;
+    finishing = false;
+    active = true;
+
+    writer = std::thread(&FrameRecorder::writerLoop, this);
+}
+
+void FrameRecorder::stop()
+{
+    if (!active) return;
+
+    // the remaining readbacks are waited for, recording is over anyway
+    while (slots[tail].fence)
+    {
+        glClientWaitSync(slots[tail].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        collect(slots[tail]);
+        tail = (tail + 1) % RING;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    file.close();
+    queue.clear();
+    spare.clear();
+    active = false;
+}
+
+void FrameRecorder::capture(const RenderTarget& source, int view_width, int view_height)
+{
+    if (!active) return;
+
+    // every buffer still in flight: waiting here is the stall this class avoids
+    Slot& slot = slots[head];
+    if (slot.fence)
+    {
+        dropped++;
+        return;
+    }
+
+    source.blitTo(fbo, view_width, view_height, frame_width, frame_height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, frame_width, frame_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    head = (head + 1) % RING;
+    captured++;
+}
+
+void FrameRecorder::poll()
+{
+    while (slots[tail].fence)
+    {
+        GLenum status = glClientWaitSync(slots[tail].fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+        collect(slots[tail]);
+        tail = (tail + 1) % RING;
+    }
+}
+
+// Copies a finished readback out of its buffer and queues it for the writer.
+void FrameRecorder::collect(Slot& slot)
+{
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    size_t bytes = size_t(frame_width) * frame_height * 4;
+    std::vector<unsigned char> pixels;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= MAX_QUEUED)
+        {
+            dropped++;
+            return;
+        }
+        if (!spare.empty())
+        {
+            pixels = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    pixels.resize(bytes);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        std::copy_n(static_cast<const unsigned char*>(mapped), bytes, pixels.data());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!mapped)
+    {
+        dropped++;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(pixels));
+    }
+    wake.notify_one();
+}
+
+void FrameRecorder::writerLoop()
+{
+    std::vector<unsigned char> yuv;
+
+    for (;;)
+    {
+        std::vector<unsigned char> pixels;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return finishing || !queue.empty(); });
+            if (queue.empty()) return;
+
+            pixels = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        RGBAToI420(pixels.data(), frame_width, frame_height, yuv);
+        file << "FRAME\n";
+        file.write(reinterpret_cast<const char*>(yuv.data()), std::streamsize(yuv.size()));
+        written++;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(pixels));
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glad/glad.h"
+#include "RenderTarget.h"
+
+// Records the scene to a Y4M video without stalling the frame. Each capture is
+// blitted (and optionally downscaled) into an 8 bit target and read into the next
+// pixel pack buffer of a small ring; poll() maps the buffers whose fences have
+// passed, a few frames later, and hands the pixels to a writer thread that
+// converts them to 4:2:0 YUV and appends them to the file. When the ring or the
+// writer falls behind, frames are dropped and counted rather than waited for.
+class FrameRecorder
+{
+public:
+	FrameRecorder() {};
+	~FrameRecorder();
+
+	// Starts a recording of a width x height scene, divided by scale_divisor.
+	// Throws if the file cannot be opened.
+	void start(const std::string& path, int width, int height, int fps);
+
+	// Writes out everything still in flight and closes the file.
+	void stop();
+
+	// Stops any recording and deletes the GL objects.
+	void release();
+
+	// Queues a readback of the lower left view_width x view_height pixels of source.
+	void capture(const RenderTarget& source, int view_width, int view_height);
+
+	// Passes finished readbacks on to the writer, in capture order.
+	void poll();
+
+	bool recording() const { return active; }
+	int frameWidth() const { return frame_width; }
+	int frameHeight() const { return frame_height; }
+
+	int scale_divisor = 1;   // 1, 2 or 4, applied by the blit on the GPU
+
+	unsigned captured = 0;
+	std::atomic<unsigned> written = 0;   // counted by the writer thread
+	unsigned dropped = 0;
+
+	static const int RING = 4;
+	static const int MAX_QUEUED = 8;   // frames waiting for the writer
+
+private:
+	struct Slot
+	{
+		GLuint pbo = 0;
+		GLsync fence = nullptr;
+	};
+
+	void releaseTargets();
+	void collect(Slot& slot);
+	void writerLoop();
+
+	bool active = false;
+	int frame_width = 0;
+	int frame_height = 0;
+
+	GLuint fbo = 0;
+	GLuint color = 0;
+	Slot slots[RING];
+	int head = 0;   // next slot to capture into
+	int tail = 0;   // oldest slot in flight
+
+	std::ofstream file;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::vector<unsigned char>> queue;    // RGBA frames, bottom row first
+	std::vector<std::vector<unsigned char>> spare;   // written buffers for reuse
+	bool finishing = false;
+};
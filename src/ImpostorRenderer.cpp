@@ -0,0 +1,251 @@
+#include "ImpostorRenderer.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstddef>
+
+static const GLuint WORKGROUP = 64;
+static const size_t INSTANCE_BYTES = 32;
+static const size_t SPLAT_BYTES = 32;
+
+// glDrawArraysIndirect layout, a four vertex strip per instance
+struct DrawArraysIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+// the command buffer as impostor_cull.glsl writes it, splats are one point each
+struct CullCommands
+{
+    DrawArraysIndirectCommand impostors;
+    DrawArraysIndirectCommand splats;
+    GLuint subpixel;
+};
+
+void ImpostorRenderer::release()
+{
+    if (fence) glDeleteSync(fence);
+    if (cullProgram) glDeleteProgram(cullProgram);
+    if (drawProgram) glDeleteProgram(drawProgram);
+    if (splatProgram) glDeleteProgram(splatProgram);
+    if (sliceCullProgram) glDeleteProgram(sliceCullProgram);
+    if (sliceProgram) glDeleteProgram(sliceProgram);
+    if (instanceSSBO) glDeleteBuffers(1, &instanceSSBO);
+    if (splatSSBO) glDeleteBuffers(1, &splatSSBO);
+    if (commandBuffer) glDeleteBuffers(1, &commandBuffer);
+    if (countBuffer) glDeleteBuffers(1, &countBuffer);
+    if (vao) glDeleteVertexArrays(1, &vao);
+    fence = nullptr;
+    cullProgram = drawProgram = splatProgram = sliceCullProgram = sliceProgram = instanceSSBO = splatSSBO = commandBuffer = countBuffer = vao = 0;
+}
+
+void ImpostorRenderer::init()
+{
+    cullProgram = LoadComputeProgram("impostor_cull.glsl");
+    cull_camera = glGetUniformLocation(cullProgram, "u_camera");
+    cull_resolution = glGetUniformLocation(cullProgram, "u_resolution");
+    cull_splat_below = glGetUniformLocation(cullProgram, "u_splat_below");
+    cull_splat = glGetUniformLocation(cullProgram, "u_splat");
+
+    GLuint vs = CompileShader(GL_VERTEX_SHADER, ReadFile("shaders/impostor_vert.glsl"), "impostor_vert.glsl");
+    GLuint fs = CompileShader(GL_FRAGMENT_SHADER, ReadFile("shaders/impostor_frag.glsl"), "impostor_frag.glsl");
+    drawProgram = LinkProgram(vs, fs);
+    draw_camera = glGetUniformLocation(drawProgram, "u_camera");
+    draw_resolution = glGetUniformLocation(drawProgram, "u_resolution");
+    draw_material_ready = glGetUniformLocation(drawProgram, "u_material_ready");
+    glUseProgram(drawProgram);
+    glUniform1i(glGetUniformLocation(drawProgram, "u_materials"), MATERIAL_UNIT);
+    glUseProgram(0);
+
+    vs = CompileShader(GL_VERTEX_SHADER, ReadFile("shaders/splat_vert.glsl"), "splat_vert.glsl");
+    fs = CompileShader(GL_FRAGMENT_SHADER, ReadFile("shaders/splat_frag.glsl"), "splat_frag.glsl");
+    splatProgram = LinkProgram(vs, fs);
+
+    sliceCullProgram = LoadComputeProgram("slice_cull.glsl");
+    slice_cull_frame = glGetUniformLocation(sliceCullProgram, "u_slice");
+    slice_cull_normal = glGetUniformLocation(sliceCullProgram, "u_slice_normal");
+    slice_cull_offset = glGetUniformLocation(sliceCullProgram, "u_slice_offset");
+    slice_cull_resolution = glGetUniformLocation(sliceCullProgram, "u_resolution");
+
+    vs = CompileShader(GL_VERTEX_SHADER, ReadFile("shaders/impostor_vert.glsl"), "impostor_vert.glsl");
+    fs = CompileShader(GL_FRAGMENT_SHADER, ReadFile("shaders/slice_frag.glsl"), "slice_frag.glsl");
+    sliceProgram = LinkProgram(vs, fs);
+    slice_frame = glGetUniformLocation(sliceProgram, "u_slice");
+    slice_normal = glGetUniformLocation(sliceProgram, "u_slice_normal");
+    slice_offset = glGetUniformLocation(sliceProgram, "u_slice_offset");
+    slice_resolution = glGetUniformLocation(sliceProgram, "u_resolution");
+
+    glGenBuffers(1, &instanceSSBO);
+    glGenBuffers(1, &splatSSBO);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &countBuffer);
+    glGenVertexArrays(1, &vao);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(CullCommands), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, countBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(CullCommands), nullptr, GL_STREAM_READ);
+}
+
+void ImpostorRenderer::allocate(size_t particle_count)
+{
+    this->particle_count = particle_count;
+
+    // at most two images per ball
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, 2 * particle_count) * INSTANCE_BYTES, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, splatSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, 2 * particle_count) * SPLAT_BYTES, nullptr, GL_DYNAMIC_COPY);
+}
+
+void ImpostorRenderer::cull(GLuint particleSSBO, const float camera[16], int width, int height)
+{
+    CullCommands cmd = { { 4, 0, 0, 0 }, { 0, 1, 0, 0 }, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd);
+
+    this->width = width;
+    this->height = height;
+    sliced = false;
+
+    if (particle_count == 0) return;
+
+    glUseProgram(cullProgram);
+    glUniformMatrix4fv(cull_camera, 1, GL_FALSE, camera);
+    glUniform2f(cull_resolution, float(width), float(height));
+    glUniform1f(cull_splat_below, splat_below);
+    glUniform1i(cull_splat, splat ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPLAT_BINDING, splatSSBO);
+
+    glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    snapshotCounts();
+}
+
+void ImpostorRenderer::cullSlice(GLuint particleSSBO, const float slice[16], const float normal[4], float offset, int width, int height)
+{
+    CullCommands cmd = { { 4, 0, 0, 0 }, { 0, 1, 0, 0 }, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd);
+
+    this->width = width;
+    this->height = height;
+    std::copy(normal, normal + 4, this->normal);
+    this->offset = offset;
+    sliced = true;
+
+    if (particle_count == 0) return;
+
+    glUseProgram(sliceCullProgram);
+    glUniformMatrix4fv(slice_cull_frame, 1, GL_FALSE, slice);
+    glUniform4fv(slice_cull_normal, 1, normal);
+    glUniform1f(slice_cull_offset, offset);
+    glUniform2f(slice_cull_resolution, float(width), float(height));
+
+    // one image per ball, the instance buffer has room for two
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+
+    glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    snapshotCounts();
+}
+
+// The command buffer is rewritten by every cull, so the counts are copied aside
+// for poll() and left alone until it has read them; the next cull never waits.
+void ImpostorRenderer::snapshotCounts()
+{
+    if (fence) return;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, countBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(CullCommands));
+
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void ImpostorRenderer::draw(GLuint particleSSBO, const float camera[16], GLuint material_ready)
+{
+    if (particle_count == 0) return;
+
+    if (sliced)
+    {
+        glUseProgram(sliceProgram);
+        glUniformMatrix4fv(slice_frame, 1, GL_FALSE, camera);
+        glUniform4fv(slice_normal, 1, normal);
+        glUniform1f(slice_offset, offset);
+        glUniform2f(slice_resolution, float(width), float(height));
+    }
+    else
+    {
+        glUseProgram(drawProgram);
+        glUniformMatrix4fv(draw_camera, 1, GL_FALSE, camera);
+        glUniform2f(draw_resolution, float(width), float(height));
+        glUniform1ui(draw_material_ready, material_ready);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceSSBO);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+
+    if (splat && !sliced)
+    {
+        // added on top of whatever they are not hidden by, alpha keeps the hit distance
+        glUseProgram(splatProgram);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPLAT_BINDING, splatSSBO);
+
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+
+        glDrawArraysIndirect(GL_POINTS, reinterpret_cast<const void*>(offsetof(CullCommands, splats)));
+
+        glDisable(GL_PROGRAM_POINT_SIZE);
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+
+    glDisable(GL_DEPTH_TEST);
+}
+
+void ImpostorRenderer::poll()
+{
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    CullCommands cmd;
+    glBindBuffer(GL_COPY_READ_BUFFER, countBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(cmd), &cmd);
+
+    visible = cmd.impostors.instanceCount;
+    splatted = cmd.splats.count;
+    subpixel = cmd.subpixel;
+}
+
+float ImpostorRenderer::subpixelShare() const
+{
+    GLuint images = visible + splatted;
+    return images ? float(subpixel) / float(images) : 0.0f;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include "glad/glad.h"
+
+// Raster path for large populations. Stereographic projection from the camera's
+// antipode sends every geodesic ball to a round ball in the camera's tangent space
+// and great-circle rays to straight rays, so each sphere becomes a screen-space
+// billboard. A compute pass projects and culls the balls (and their antipodal
+// images) and writes the surviving instances plus the indirect draw command.
+// The impostor fragment solves the great-circle hit exactly and writes t as depth.
+// With splatting on, images below splat_below pixels become additive points
+// instead, which keeps the raster cost flat once most balls are sub-pixel.
+// cullSlice() swaps the projection for a cross-section: each ball cut by a 3D
+// hyperplane is drawn as the ordinary 3D ball left over, through the same
+// instance list and indirect draw.
+class ImpostorRenderer
+{
+public:
+	ImpostorRenderer() {};
+	~ImpostorRenderer() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count);
+
+	// camera is the column-major frame from Camera::frame_matrix
+	void cull(GLuint particleSSBO, const float camera[16], int width, int height);
+
+	// Cross-section by the hyperplane dot(x, normal) = offset instead, seen from
+	// slice, a frame_matrix whose columns all lie in the hyperplane. Never splats.
+	void cullSlice(GLuint particleSSBO, const float slice[16], const float normal[4], float offset, int width, int height);
+
+	// Draws the instances written by the last cull, depth tested against the
+	// current depth buffer, then the splats on top of them. The caller has
+	// already drawn the background and bound the materials at MATERIAL_UNIT;
+	// material_ready is MaterialLibrary::readyMask. After cullSlice, camera is
+	// the slice frame and the cross-sections are flat colored.
+	void draw(GLuint particleSSBO, const float camera[16], GLuint material_ready);
+
+	// Picks up the counts of the last cull once the GPU is done with it.
+	void poll();
+
+	// Share of the on-screen images below splat_below pixels in the last cull.
+	float subpixelShare() const;
+
+	bool splat = false;          // route sub-pixel images to points
+	float splat_below = 2.0f;    // projected diameter in pixels
+
+	// a frame or two late
+	GLuint visible = 0;    // impostors drawn
+	GLuint splatted = 0;   // splats drawn
+	GLuint subpixel = 0;   // images below splat_below, splatted or not
+
+	static const GLuint INSTANCE_BINDING = 6;
+	static const GLuint COMMAND_BINDING = 7;
+	static const GLuint SPLAT_BINDING = 10;
+	static const GLuint MATERIAL_UNIT = 4;
+
+	// automatic switch to splatting, with some hysteresis
+	static constexpr float SPLAT_ON_SHARE = 0.9f;
+	static constexpr float SPLAT_OFF_SHARE = 0.75f;
+	static const GLuint SPLAT_MIN_IMAGES = 4096;   // small scenes stay exact
+
+private:
+	void snapshotCounts();
+
+	GLuint cullProgram = 0;
+	GLuint cull_camera = 0;
+	GLuint cull_resolution = 0;
+	GLuint cull_splat_below = 0;
+	GLuint cull_splat = 0;
+
+	GLuint drawProgram = 0;
+	GLuint draw_camera = 0;
+	GLuint draw_resolution = 0;
+	GLuint draw_material_ready = 0;
+
+	GLuint splatProgram = 0;
+
+	GLuint sliceCullProgram = 0;
+	GLuint slice_cull_frame = 0;
+	GLuint slice_cull_normal = 0;
+	GLuint slice_cull_offset = 0;
+	GLuint slice_cull_resolution = 0;
+
+	GLuint sliceProgram = 0;
+	GLuint slice_frame = 0;
+	GLuint slice_normal = 0;
+	GLuint slice_offset = 0;
+	GLuint slice_resolution = 0;
+
+	GLuint instanceSSBO = 0;
+	GLuint splatSSBO = 0;
+	GLuint commandBuffer = 0;
+	GLuint countBuffer = 0;    // copy of the counts poll() reads, see snapshotCounts
+	GLuint vao = 0;
+
+	size_t particle_count = 0;
+	int width = 0;
+	int height = 0;
+	bool sliced = false;   // the last cull was cullSlice
+	float normal[4] = {};
+	float offset = 0.0f;
+	GLsync fence = nullptr;
+};
@@ -0,0 +1,113 @@
+#include "MarchSeed.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const GLuint WORKGROUP = 64;
+
+void MarchSeed::release()
+{
+    if (program) glDeleteProgram(program);
+    if (previousSSBO) glDeleteBuffers(1, &previousSSBO);
+    if (motionSSBO) glDeleteBuffers(1, &motionSSBO);
+    if (images[0]) glDeleteTextures(2, images);
+    program = previousSSBO = motionSSBO = 0;
+    images[0] = images[1] = 0;
+}
+
+void MarchSeed::init()
+{
+    program = LoadComputeProgram("seed_motion.glsl");
+    u_valid = glGetUniformLocation(program, "u_valid");
+
+    glGenBuffers(1, &previousSSBO);
+
+    glGenBuffers(1, &motionSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, motionSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+}
+
+void MarchSeed::allocate(size_t particle_count)
+{
+    this->particle_count = particle_count;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, previousSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(particle_count, 1) * 4 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+
+    history_valid = false;
+}
+
+void MarchSeed::resize(int width, int height)
+{
+    if (width == this->width && height == this->height) return;
+
+    this->width = width;
+    this->height = height;
+
+    if (images[0]) glDeleteTextures(2, images);
+    glGenTextures(2, images);
+
+    // zeroed texels carry frame tag 0, which never matches
+    const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, images[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+        glClearTexImage(images[i], 0, GL_RGBA, GL_FLOAT, zero);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    history_valid = false;
+}
+
+void MarchSeed::update(GLuint particleSSBO, const float camera[16], int scene_width, int scene_height)
+{
+    // last frame's pixels are other rays at another resolution
+    if (scene_width != this->scene_width || scene_height != this->scene_height)
+        history_valid = false;
+
+    this->scene_width = scene_width;
+    this->scene_height = scene_height;
+
+    std::memcpy(prev_camera, this->camera, sizeof(prev_camera));
+    std::memcpy(this->camera, camera, sizeof(this->camera));
+
+    // columns right, up, front, pos: the position is the last one
+    const float* p = camera + 12;
+    const float* q = prev_camera + 12;
+    float cos_shift = std::clamp(p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3], -1.0f, 1.0f);
+    camera_shift = history_valid ? std::acos(cos_shift) : 1e6f;
+
+    // a fresh tag makes every texel of the other image stale
+    frame_index += history_valid ? 1 : 2;
+    current = 1 - current;
+
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, motionSSBO);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    // the images were written by last frame's draw
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (particle_count > 0)
+    {
+        glUseProgram(program);
+        glUniform1i(u_valid, history_valid ? 1 : 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, previousSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MOTION_BINDING, motionSSBO);
+        glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    history_valid = true;
+}
+
+void MarchSeed::bind() const
+{
+    glBindImageTexture(READ_UNIT, images[1 - current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(WRITE_UNIT, images[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MOTION_BINDING, motionSSBO);
+}
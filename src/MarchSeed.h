@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include "glad/glad.h"
+
+// Starts each ray of the sphere tracer near where the previous frame stopped.
+// frag.glsl stores per pixel how far along the ray it found an empty tube, and
+// the tube radius, in an RGBA32F image tagged with the frame number. Next frame
+// a ray skips the shortest tube in the 3x3 neighbourhood it reprojects to, as
+// long as the camera's geodesic shift, the spread of neighbouring rays and the
+// largest sphere motion (measured here on the GPU) fit inside the tube. Two
+// images alternate between being written and read.
+class MarchSeed
+{
+public:
+	MarchSeed() {};
+	~MarchSeed() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count);
+
+	// Storage follows the window, like the scene target.
+	void resize(int width, int height);
+
+	// Call once per frame before rendering: measures the sphere motion since the
+	// last frame and swaps the images. camera is Camera::frame_matrix.
+	void update(GLuint particleSSBO, const float camera[16], int scene_width, int scene_height);
+
+	// Image units 2 (last frame, read) and 3 (this frame, written) and the motion buffer.
+	void bind() const;
+
+	// Drops the history, e.g. when the spheres or the camera jumped.
+	void invalidate() { history_valid = false; }
+
+	// Frame tag of this frame's image; last frame's is one less.
+	int frame() const { return frame_index; }
+
+	// Geodesic distance the camera moved since the last frame.
+	float cameraShift() const { return camera_shift; }
+
+	const float* previousCamera() const { return prev_camera; }
+
+	static const GLuint READ_UNIT = 2;
+	static const GLuint WRITE_UNIT = 3;
+	static const GLuint MOTION_BINDING = 9;
+
+private:
+	GLuint program = 0;
+	GLuint u_valid = 0;
+
+	GLuint previousSSBO = 0;
+	GLuint motionSSBO = 0;
+	GLuint images[2] = { 0, 0 };
+
+	size_t particle_count = 0;
+	int width = 0;
+	int height = 0;
+	int scene_width = 0;
+	int scene_height = 0;
+
+	int current = 0;
+	int frame_index = 1;
+	bool history_valid = false;
+
+	float camera[16] = {};
+	float prev_camera[16] = {};
+	float camera_shift = 0.0f;
+};
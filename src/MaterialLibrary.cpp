@@ -0,0 +1,244 @@
+#include "MaterialLibrary.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+
+static size_t ChainBytes()
+{
+    size_t bytes = 0;
+    for (int level = 0; level < MaterialLibrary::LEVELS; level++)
+    {
+        size_t size = size_t(std::max(1, MaterialLibrary::SIZE >> level));
+        bytes += size * size * 4;
+    }
+    return bytes;
+}
+
+// Bilinear resample of an RGBA image to SIZE x SIZE.
+static void Resample(const unsigned char* src, int width, int height, unsigned char* dst)
+{
+    const int size = MaterialLibrary::SIZE;
+    for (int y = 0; y < size; y++)
+    {
+        float fy = std::clamp((y + 0.5f) * height / size - 0.5f, 0.0f, float(height - 1));
+        int y0 = int(fy);
+        int y1 = std::min(y0 + 1, height - 1);
+        float ty = fy - y0;
+
+        for (int x = 0; x < size; x++)
+        {
+            float fx = std::clamp((x + 0.5f) * width / size - 0.5f, 0.0f, float(width - 1));
+            int x0 = int(fx);
+            int x1 = std::min(x0 + 1, width - 1);
+            float tx = fx - x0;
+
+            for (int c = 0; c < 4; c++)
+            {
+                float a = src[(size_t(y0) * width + x0) * 4 + c] * (1 - tx) + src[(size_t(y0) * width + x1) * 4 + c] * tx;
+                float b = src[(size_t(y1) * width + x0) * 4 + c] * (1 - tx) + src[(size_t(y1) * width + x1) * 4 + c] * tx;
+                dst[(size_t(y) * size + x) * 4 + c] = (unsigned char)(a * (1 - ty) + b * ty + 0.5f);
+            }
+        }
+    }
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quitting = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void MaterialLibrary::release()
+{
+    for (int i = 0; i < RING; i++)
+    {
+        if (fences[i]) glDeleteSync(fences[i]);
+        if (pbos[i]) glDeleteBuffers(1, &pbos[i]);
+        fences[i] = nullptr;
+        pbos[i] = 0;
+    }
+    if (texture) glDeleteTextures(1, &texture);
+    texture = 0;
+}
+
+int MaterialLibrary::scan(const std::string& directory)
+{
+    namespace fs = std::filesystem;
+
+    paths.clear();
+
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) return 0;
+
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory, error))
+    {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" ||
+            extension == ".bmp" || extension == ".ppm" || extension == ".pgm")
+            paths.push_back(entry.path().string());
+    }
+
+    std::sort(paths.begin(), paths.end());
+    if (paths.size() > size_t(MAX_MATERIALS)) paths.resize(MAX_MATERIALS);
+
+    return count();
+}
+
+void MaterialLibrary::init()
+{
+    // one layer even without materials, so the sampler is always complete
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, LEVELS, GL_RGBA8, SIZE, SIZE, std::max(1, count()));
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (paths.empty()) return;
+
+    glGenBuffers(RING, pbos);
+    for (int i = 0; i < RING; i++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(ChainBytes()), nullptr, GL_MAP_WRITE_BIT);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (int layer = 0; layer < count(); layer++) jobs.push_back(layer);
+
+    // decoding is the slow part, leave a core for the render thread
+    int threads = std::clamp(int(std::thread::hardware_concurrency()) - 1, 1, 4);
+    threads = std::min(threads, count());
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&MaterialLibrary::workerLoop, this);
+}
+
+void MaterialLibrary::poll()
+{
+    if (loaded_count + failed_count == count()) return;
+
+    // the buffer is still being read by an earlier upload
+    GLsync& fence = fences[next_pbo];
+    if (fence)
+    {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    Decoded image;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done.empty()) return;
+        image = std::move(done.front());
+        done.pop_front();
+    }
+
+    if (!image.ok)
+    {
+        failed_count++;
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[next_pbo]);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(image.levels.size()),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        failed_count++;
+        return;
+    }
+    std::memcpy(mapped, image.levels.data(), image.levels.size());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    size_t offset = 0;
+    for (int level = 0; level < LEVELS; level++)
+    {
+        int size = std::max(1, SIZE >> level);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, image.layer, size, size, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+        offset += size_t(size) * size * 4;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    next_pbo = (next_pbo + 1) % RING;
+
+    // later draws see the upload, commands execute in order
+    ready_mask |= 1u << image.layer;
+    loaded_count++;
+}
+
+void MaterialLibrary::bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void MaterialLibrary::workerLoop()
+{
+    for (;;)
+    {
+        int layer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quitting || !jobs.empty(); });
+            if (quitting) return;
+
+            layer = jobs.front();
+            jobs.pop_front();
+        }
+
+        Decoded image;
+        image.layer = layer;
+
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(paths[layer].c_str(), &width, &height, &channels, 4);
+        if (pixels)
+        {
+            image.levels.resize(ChainBytes());
+            Resample(pixels, width, height, image.levels.data());
+            stbi_image_free(pixels);
+
+            // 2x2 box filter down the chain
+            unsigned char* level = image.levels.data();
+            for (int size = SIZE; size > 1; size /= 2)
+            {
+                unsigned char* next = level + size_t(size) * size * 4;
+                int half = size / 2;
+                for (int y = 0; y < half; y++)
+                    for (int x = 0; x < half; x++)
+                        for (int c = 0; c < 4; c++)
+                        {
+                            int sum = level[((size_t(2 * y) * size) + 2 * x) * 4 + c] + level[((size_t(2 * y) * size) + 2 * x + 1) * 4 + c] +
+                                level[((size_t(2 * y + 1) * size) + 2 * x) * 4 + c] + level[((size_t(2 * y + 1) * size) + 2 * x + 1) * 4 + c];
+                            next[(size_t(y) * half + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                        }
+                level = next;
+            }
+            image.ok = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        done.push_back(std::move(image));
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glad/glad.h"
+
+// Sphere surface textures, one layer of a mipmapped 2D array per image found in
+// a directory. Worker threads decode the files with stb_image, resample them to
+// SIZE x SIZE and build the mip chain; poll() uploads at most one finished image
+// a frame through a small ring of pixel unpack buffers. Shaders get a bit per
+// layer in readyMask() and keep the sphere's flat color until its layer is in.
+class MaterialLibrary
+{
+public:
+	MaterialLibrary() {};
+	~MaterialLibrary();
+
+	// Lists the images in directory, sorted by name; no GL needed, so particles
+	// can be given layers before the context exists. Returns the layer count.
+	int scan(const std::string& directory);
+
+	// Allocates the array and starts decoding the scanned files.
+	void init();
+	void release();
+
+	// Uploads the next decoded image, if any and if its buffer is free.
+	void poll();
+
+	void bind(GLuint unit) const;
+
+	// Layer of the n-th textured sphere, -1 when there are no materials.
+	int layerFor(int n) const { return count() > 0 ? n % count() : -1; }
+
+	int count() const { return int(paths.size()); }
+	int loaded() const { return loaded_count; }
+	int failed() const { return failed_count; }
+	GLuint readyMask() const { return ready_mask; }
+
+	static const int SIZE = 512;
+	static const int LEVELS = 10;          // 512 down to 1
+	static const int MAX_MATERIALS = 32;   // one bit of readyMask() each
+
+private:
+	struct Decoded
+	{
+		int layer = 0;
+		bool ok = false;
+		std::vector<unsigned char> levels;   // RGBA8 mip chain, level 0 first
+	};
+
+	void workerLoop();
+
+	std::vector<std::string> paths;
+
+	GLuint texture = 0;
+	static const int RING = 2;
+	GLuint pbos[RING] = {};
+	GLsync fences[RING] = {};
+	int next_pbo = 0;
+
+	GLuint ready_mask = 0;
+	int loaded_count = 0;
+	int failed_count = 0;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<int> jobs;        // layers still to decode
+	std::deque<Decoded> done;    // decoded, waiting for poll()
+	bool quitting = false;
+};
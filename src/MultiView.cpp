@@ -0,0 +1,140 @@
+#include "MultiView.h"
+
+#include <algorithm>
+#include <cmath>
+
+// std140 layout of ViewBlock
+struct ViewGPU
+{
+    float camera[16];
+    float rect[4];   // x, y, width, height in scene pixels
+};
+
+struct ViewBlockGPU
+{
+    ViewGPU views[MultiView::MAX_VIEWS];
+    GLint view_count;
+    GLint pad[3];
+};
+
+static const float INSET_SCALE = 0.28f;   // inset views, as a share of the scene height
+static const int INSET_MARGIN = 8;
+
+static float Det4(const Vec4& a, const Vec4& b, const Vec4& c, const Vec4& d)
+{
+    // expansion along the first row of the matrix with columns a, b, c, d
+    auto det3 = [](float a1, float a2, float a3, float b1, float b2, float b3, float c1, float c2, float c3)
+    {
+        return a1 * (b2 * c3 - b3 * c2) - a2 * (b1 * c3 - b3 * c1) + a3 * (b1 * c2 - b2 * c1);
+    };
+    return a.x * det3(b.y, c.y, d.y, b.z, c.z, d.z, b.w, c.w, d.w)
+         - b.x * det3(a.y, c.y, d.y, a.z, c.z, d.z, a.w, c.w, d.w)
+         + c.x * det3(a.y, b.y, d.y, a.z, b.z, d.z, a.w, b.w, d.w)
+         - d.x * det3(a.y, b.y, c.y, a.z, b.z, c.z, a.w, b.w, c.w);
+}
+
+// the longest of the candidates once the given unit vectors are projected out
+static Vec4 Orthogonal(const Vec4* against, int n, const Vec4* candidates, int m)
+{
+    Vec4 best;
+    for (int i = 0; i < m; i++)
+    {
+        Vec4 v = candidates[i];
+        for (int k = 0; k < n; k++) v -= against[k] * v.dot(against[k]);
+        if (v.length2() > best.length2()) best = v;
+    }
+    return best.normalized();
+}
+
+// Same position, looking along the world w axis as far as the tangent space allows.
+static void WAxisFrame(const Camera& main, float out[16])
+{
+    Vec4 axes[3] = { main.right, main.up, main.front };
+
+    Vec4 w_axis(0, 0, 0, 1);
+    Vec4 front = w_axis.project_tangent(main.pos);
+    front = front.length2() > 1e-6f ? front.normalized() : main.up;
+
+    Vec4 basis[3] = { main.pos, front };
+    Vec4 ups[2] = { main.front, main.up };
+    Vec4 up = Orthogonal(basis, 2, ups, 2);
+
+    basis[2] = up;
+    Vec4 right = Orthogonal(basis, 3, axes, 3);
+
+    // keep the orientation of the main frame, a mirrored view would look wrong
+    if (Det4(right, up, front, main.pos) < 0.0f) right = right * -1.0f;
+
+    Camera view = main;
+    view.right = right;
+    view.up = up;
+    view.front = front;
+    view.frame_matrix(out);
+}
+
+static void SetRect(ViewGPU& view, int x, int y, int w, int h)
+{
+    view.rect[0] = float(x);
+    view.rect[1] = float(y);
+    view.rect[2] = float(w);
+    view.rect[3] = float(h);
+}
+
+void MultiView::release()
+{
+    if (ubo) glDeleteBuffers(1, &ubo);
+    ubo = 0;
+}
+
+void MultiView::init()
+{
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewBlockGPU), nullptr, GL_DYNAMIC_DRAW);
+}
+
+void MultiView::update(bool active, const Camera& main, const Camera& second, int width, int height)
+{
+    ViewBlockGPU block = {};
+    view_count = 0;
+
+    if (active && preset != SINGLE)
+    {
+        int inset_h = std::max(1, int(height * INSET_SCALE));
+        int inset_w = std::max(1, inset_h * width / std::max(1, height));
+
+        main.frame_matrix(block.views[0].camera);
+        SetRect(block.views[0], 0, 0, width, height);
+
+        if (preset == REAR_VIEW)
+        {
+            // a mirror at the top: turned half way round, left and right swapped
+            Camera rear = main;
+            rear.yaw(3.14159265f);
+            rear.right = rear.right * -1.0f;
+            rear.frame_matrix(block.views[1].camera);
+            SetRect(block.views[1], (width - inset_w) / 2, height - inset_h - INSET_MARGIN, inset_w, inset_h / 2);
+        }
+        else if (preset == W_AXIS_VIEW)
+        {
+            WAxisFrame(main, block.views[1].camera);
+            SetRect(block.views[1], width - inset_w - INSET_MARGIN, INSET_MARGIN, inset_w, inset_h);
+        }
+        else
+        {
+            SetRect(block.views[0], 0, 0, width / 2, height);
+            second.frame_matrix(block.views[1].camera);
+            SetRect(block.views[1], width / 2, 0, width - width / 2, height);
+        }
+        view_count = 2;
+    }
+
+    block.view_count = view_count;
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+}
+
+void MultiView::bind() const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BINDING, ubo);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "glad/glad.h"
+#include "Camera.h"
+
+// Several cameras marched in the same fullscreen pass. A uniform block holds a
+// camera frame and a pixel rectangle per view; frag.glsl picks the last view
+// whose rectangle contains the pixel, so inset views draw over the main one,
+// and tile_cull.glsl bins every view into the one set of screen tiles. The
+// sphere hierarchy and distance field do not depend on the camera and serve
+// every view as they are.
+class MultiView
+{
+public:
+	MultiView() {};
+	~MultiView() {};
+
+	void init();
+	void release();
+
+	// Lays the views of the preset out over a width x height scene and uploads
+	// them, or a view count of zero (u_camera over the whole target) when not
+	// active. second is player two's camera for the split screen.
+	void update(bool active, const Camera& main, const Camera& second, int width, int height);
+
+	// Binds the block at the binding frag.glsl and tile_cull.glsl read it from.
+	void bind() const;
+
+	int count() const { return view_count; }
+
+	enum Preset { SINGLE, REAR_VIEW, W_AXIS_VIEW, SPLIT_SCREEN };
+	int preset = SINGLE;
+
+	static const int MAX_VIEWS = 4;
+	static const GLuint VIEW_BINDING = 0;
+
+private:
+	GLuint ubo = 0;
+	int view_count = 0;
+};
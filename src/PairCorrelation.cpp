@@ -0,0 +1,132 @@
+#include "PairCorrelation.h"
+#include "Shader.h"
+
+#include <cmath>
+#include <fstream>
+
+static const GLuint WORKGROUP = 64;
+static const float PI = 3.14159265359f;
+
+// fraction of uniformly placed pairs closer than r, the pdf on S^3 is (2/pi) sin^2 r
+static double UniformCDF(double r)
+{
+    return (r - std::sin(r) * std::cos(r)) / PI;
+}
+
+void PairCorrelation::release()
+{
+    if (fence) glDeleteSync(fence);
+    if (program) glDeleteProgram(program);
+    if (histogramSSBO) glDeleteBuffers(1, &histogramSSBO);
+    fence = nullptr;
+    program = histogramSSBO = 0;
+}
+
+void PairCorrelation::init()
+{
+    program = LoadComputeProgram("pair_histogram.glsl");
+    u_sampled = glGetUniformLocation(program, "sampled");
+    u_samples = glGetUniformLocation(program, "samples");
+    u_seed = glGetUniformLocation(program, "seed");
+
+    glGenBuffers(1, &histogramSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, BINS * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+
+    pair_density.assign(BINS, 0.0f);
+    correlation.assign(BINS, 0.0f);
+}
+
+void PairCorrelation::allocate(size_t particle_count)
+{
+    this->particle_count = particle_count;
+
+    total_pairs = 0.0;
+    mean_distance = 0.0f;
+    pair_density.assign(BINS, 0.0f);
+    correlation.assign(BINS, 0.0f);
+}
+
+void PairCorrelation::dispatch(GLuint particleSSBO, float sim_time)
+{
+    if (particle_count < 2) return;
+
+    bool use_sampling = force_sampling || particle_count > SAMPLE_THRESHOLD;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramSSBO);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    glUseProgram(program);
+    glUniform1i(u_sampled, use_sampling ? 1 : 0);
+    glUniform1ui(u_samples, GLuint(samples_per_body));
+    glUniform1ui(u_seed, seed++);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, histogramSSBO);
+
+    glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence_time = sim_time;
+    fence_sampled = use_sampling;
+}
+
+void PairCorrelation::poll()
+{
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    GLuint counts[BINS];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+
+    double sum = 0.0;
+    for (int i = 0; i < BINS; i++) sum += counts[i];
+    if (sum == 0.0) return;
+
+    const double width = PI / BINS;
+    double weighted = 0.0;
+
+    for (int i = 0; i < BINS; i++)
+    {
+        double lo = i * width;
+        double hi = lo + width;
+        double fraction = counts[i] / sum;
+        double expected = UniformCDF(hi) - UniformCDF(lo);
+
+        pair_density[i] = float(fraction);
+        correlation[i] = float(fraction / expected - 1.0);
+        weighted += fraction * (lo + 0.5 * width);
+    }
+
+    mean_distance = float(weighted);
+    total_pairs = 0.5 * double(particle_count) * double(particle_count - 1);
+    sampled = fence_sampled;
+
+    if (log_to_file) writeLog();
+}
+
+void PairCorrelation::writeLog()
+{
+    std::ofstream out(log_path, log_started ? std::ios::app : std::ios::trunc);
+    if (!out) return;
+
+    if (!log_started)
+    {
+        out << "sim_time,bodies,sampled";
+        for (int i = 0; i < BINS; i++) out << ",xi_" << i;
+        out << "\n";
+        log_started = true;
+    }
+
+    out << fence_time << "," << particle_count << "," << (sampled ? 1 : 0);
+    for (int i = 0; i < BINS; i++) out << "," << correlation[i];
+    out << "\n";
+}
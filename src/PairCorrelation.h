@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "glad/glad.h"
+
+// Histogram of pairwise geodesic distances accumulated on the GPU, plus the
+// two-point correlation xi(r) = DD / RR - 1 against a uniform distribution on S^3.
+// Large populations switch to sampling a fixed number of partners per body.
+class PairCorrelation
+{
+public:
+	PairCorrelation() {};
+	~PairCorrelation() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count);
+
+	void dispatch(GLuint particleSSBO, float sim_time);
+	void poll();
+
+	bool hasResult() const { return total_pairs > 0.0; }
+	float meanDistance() const { return mean_distance; }
+
+	static const int BINS = 256;
+
+	bool force_sampling = false;
+	int samples_per_body = 256;
+	bool log_to_file = false;
+	std::string log_path = "pair_correlation.csv";
+
+	std::vector<float> pair_density;   // fraction of pairs per bin
+	std::vector<float> correlation;    // xi(r) per bin
+	double total_pairs = 0.0;
+	bool sampled = false;             // whether the current result came from sampling
+
+	const size_t SAMPLE_THRESHOLD = 20000;
+
+private:
+	void writeLog();
+
+	GLuint program = 0;
+	GLuint u_sampled = 0;
+	GLuint u_samples = 0;
+	GLuint u_seed = 0;
+
+	GLuint histogramSSBO = 0;
+
+	size_t particle_count = 0;
+	GLsync fence = nullptr;
+	float fence_time = 0.0f;
+	bool fence_sampled = false;
+	GLuint seed = 0;
+
+	float mean_distance = 0.0f;
+	bool log_started = false;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "glad/glad.h"
+
+// Offscreen RGBA16F color + depth target the scene is rendered into at a
+// fraction of the window size, then scaled up to the default framebuffer.
+// Storage follows the window; a lower render scale only shrinks the viewport
+// inside it, so changing the scale never reallocates.
+class RenderTarget
+{
+public:
+	RenderTarget() {};
+	~RenderTarget() {};
+
+	// Reallocates the attachments when the size changes, returns true if it did.
+	bool resize(int width, int height);
+
+	// Binds for rendering into the lower left view_width x view_height pixels.
+	void bind(int view_width, int view_height) const;
+
+	// Linear filtered copy of that view into the given framebuffer.
+	void blitTo(GLuint framebuffer, int view_width, int view_height, int width, int height) const;
+
+	// Blocking readback of that view as 8 bit RGB rows, bottom row first.
+	void readPixels(int view_width, int view_height, unsigned char* rgb) const;
+
+	void release();
+
+	int width() const { return target_width; }
+	int height() const { return target_height; }
+	GLuint colorTexture() const { return color; }
+
+private:
+	GLuint fbo = 0;
+	GLuint color = 0;
+	GLuint depth = 0;
+
+	int target_width = 0;
+	int target_height = 0;
+};
@@ -0,0 +1,229 @@
+#include "RewindBuffer.h"
+#include "Shader.h"
+
+#include <algorithm>
+
+static const size_t DELTA_BYTES = 16; // uvec4 of half floats per particle
+static const GLuint WORKGROUP = 64;
+
+void RewindBuffer::release()
+{
+    if (encodeProgram) glDeleteProgram(encodeProgram);
+    if (applyProgram) glDeleteProgram(applyProgram);
+    if (keyframeSSBO) glDeleteBuffers(1, &keyframeSSBO);
+    if (deltaSSBO) glDeleteBuffers(1, &deltaSSBO);
+    if (roundStartSSBO) glDeleteBuffers(1, &roundStartSSBO);
+    encodeProgram = applyProgram = keyframeSSBO = deltaSSBO = roundStartSSBO = 0;
+}
+
+void RewindBuffer::init()
+{
+    encodeProgram = LoadComputeProgram("rewind_encode.glsl");
+    applyProgram = LoadComputeProgram("rewind_apply.glsl");
+
+    u_encode_key_base = glGetUniformLocation(encodeProgram, "key_base");
+    u_encode_delta_base = glGetUniformLocation(encodeProgram, "delta_base");
+    u_apply_key_base = glGetUniformLocation(applyProgram, "key_base");
+    u_apply_delta_base = glGetUniformLocation(applyProgram, "delta_base");
+
+    glGenBuffers(1, &keyframeSSBO);
+    glGenBuffers(1, &deltaSSBO);
+    glGenBuffers(1, &roundStartSSBO);
+}
+
+void RewindBuffer::allocate(size_t particle_count, size_t particle_size)
+{
+    this->particle_count = particle_count;
+    frame_bytes = particle_count * particle_size;
+
+    // every record costs one delta plus its share of a keyframe
+    size_t per_record = particle_count * DELTA_BYTES + frame_bytes / KEYFRAME_INTERVAL + 1;
+    size_t wanted = size_t(SECONDS * RECORD_RATE);
+    size_t capacity = std::max<size_t>(2, std::min(wanted, MEMORY_BUDGET / per_record));
+
+    records.assign(capacity, Record{});
+    keyframe_slots = int(capacity) / KEYFRAME_INTERVAL + 2;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, keyframeSSBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, keyframe_slots * frame_bytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, deltaSSBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * particle_count * DELTA_BYTES, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, roundStartSSBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, frame_bytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    reset();
+}
+
+void RewindBuffer::reset()
+{
+    tail = 0;
+    count = 0;
+    next_keyframe = 0;
+    current_keyframe = -1;
+    records_since_keyframe = 0;
+    round_start_valid = false;
+}
+
+float RewindBuffer::oldestTime() const
+{
+    return count > 0 ? recordAt(0).time : 0.0f;
+}
+
+float RewindBuffer::newestTime() const
+{
+    return count > 0 ? recordAt(count - 1).time : 0.0f;
+}
+
+void RewindBuffer::dropKeyframe(int slot)
+{
+    while (count > 0 && recordAt(0).keyframe == slot)
+    {
+        tail = (tail + 1) % records.size();
+        count--;
+    }
+}
+
+void RewindBuffer::dropNewerThan(float sim_time)
+{
+    if (count == 0 || newestTime() < sim_time) return;
+
+    while (count > 0 && recordAt(count - 1).time >= sim_time)
+        count--;
+
+    if (count == 0)
+    {
+        current_keyframe = -1;
+        records_since_keyframe = 0;
+        return;
+    }
+
+    current_keyframe = recordAt(count - 1).keyframe;
+    next_keyframe = (current_keyframe + 1) % keyframe_slots;
+
+    records_since_keyframe = 0;
+    for (int i = count - 1; i >= 0 && recordAt(i).keyframe == current_keyframe; i--)
+        records_since_keyframe++;
+}
+
+void RewindBuffer::record(GLuint particleSSBO, float sim_time)
+{
+    if (records.empty() || particle_count == 0) return;
+
+    dropNewerThan(sim_time);
+
+    if (count > 0 && sim_time - newestTime() < 1.0f / RECORD_RATE)
+        return;
+
+    if (count == int(records.size()))
+    {
+        tail = (tail + 1) % records.size();
+        count--;
+    }
+
+    int slot = (tail + count) % records.size();
+    Record rec;
+    rec.time = sim_time;
+
+    if (current_keyframe < 0 || records_since_keyframe >= KEYFRAME_INTERVAL)
+    {
+        int key = next_keyframe;
+        dropKeyframe(key);
+        slot = (tail + count) % records.size();
+
+        glBindBuffer(GL_COPY_READ_BUFFER, particleSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, keyframeSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, key * frame_bytes, frame_bytes);
+
+        current_keyframe = key;
+        next_keyframe = (key + 1) % keyframe_slots;
+        records_since_keyframe = 0;
+
+        rec.keyframe = key;
+        rec.delta = -1;
+    }
+    else
+    {
+        glUseProgram(encodeProgram);
+        glUniform1ui(u_encode_key_base, GLuint(current_keyframe * particle_count));
+        glUniform1ui(u_encode_delta_base, GLuint(slot * particle_count));
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keyframeSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, deltaSSBO);
+
+        glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        rec.keyframe = current_keyframe;
+        rec.delta = slot;
+    }
+
+    records_since_keyframe++;
+    records[slot] = rec;
+    count++;
+}
+
+float RewindBuffer::restore(GLuint particleSSBO, float sim_time)
+{
+    if (count == 0) return sim_time;
+
+    int index = 0;
+    for (int i = count - 1; i >= 0; i--)
+    {
+        if (recordAt(i).time <= sim_time)
+        {
+            index = i;
+            break;
+        }
+    }
+
+    const Record& rec = recordAt(index);
+
+    if (rec.delta < 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, keyframeSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, particleSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, rec.keyframe * frame_bytes, 0, frame_bytes);
+    }
+    else
+    {
+        glUseProgram(applyProgram);
+        glUniform1ui(u_apply_key_base, GLuint(rec.keyframe * particle_count));
+        glUniform1ui(u_apply_delta_base, GLuint(rec.delta * particle_count));
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keyframeSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, deltaSSBO);
+
+        glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    return rec.time;
+}
+
+void RewindBuffer::markRoundStart(GLuint particleSSBO, float sim_time)
+{
+    if (frame_bytes == 0) return;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, particleSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, roundStartSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, frame_bytes);
+
+    round_start_valid = true;
+    round_start_time = sim_time;
+}
+
+float RewindBuffer::restoreRoundStart(GLuint particleSSBO)
+{
+    if (!round_start_valid) return 0.0f;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, roundStartSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, particleSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, frame_bytes);
+
+    dropNewerThan(round_start_time + 0.5f / RECORD_RATE);
+
+    return round_start_time;
+}
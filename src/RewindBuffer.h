@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "glad/glad.h"
+
+// Keeps the last few seconds of the particle SSBO on the GPU so a round can be
+// scrubbed or retried without re-simulating. Full keyframes are taken every
+// KEYFRAME_INTERVAL records, the records in between only store half-float
+// position/velocity deltas against their keyframe. Nothing here touches CPU memory.
+class RewindBuffer
+{
+public:
+	RewindBuffer() {};
+	~RewindBuffer() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count, size_t particle_size);
+	void reset();
+
+	// Snapshots the SSBO if at least one record period passed since the last record.
+	// Records newer than sim_time are dropped first, so recording after a restore
+	// continues the new timeline.
+	void record(GLuint particleSSBO, float sim_time);
+
+	// Restores the newest record at or before sim_time, returns the time of that record.
+	float restore(GLuint particleSSBO, float sim_time);
+
+	void markRoundStart(GLuint particleSSBO, float sim_time);
+	float restoreRoundStart(GLuint particleSSBO);
+
+	bool empty() const { return count == 0; }
+	bool hasRoundStart() const { return round_start_valid; }
+	float oldestTime() const;
+	float newestTime() const;
+
+	static constexpr float SECONDS = 10.0f;
+	static constexpr float RECORD_RATE = 30.0f;
+	static constexpr int KEYFRAME_INTERVAL = 30;
+	static constexpr size_t MEMORY_BUDGET = 256u << 20;
+
+private:
+	struct Record
+	{
+		float time;
+		int keyframe;
+		int delta;   // -1 when the record is the keyframe itself
+	};
+
+	const Record& recordAt(int i) const { return records[(tail + i) % records.size()]; }
+	void dropNewerThan(float sim_time);
+	void dropKeyframe(int slot);
+
+	GLuint encodeProgram = 0;
+	GLuint applyProgram = 0;
+	GLuint u_encode_key_base = 0;
+	GLuint u_encode_delta_base = 0;
+	GLuint u_apply_key_base = 0;
+	GLuint u_apply_delta_base = 0;
+
+	GLuint keyframeSSBO = 0;
+	GLuint deltaSSBO = 0;
+	GLuint roundStartSSBO = 0;
+
+	size_t particle_count = 0;
+	size_t frame_bytes = 0;
+
+	std::vector<Record> records;
+	int tail = 0;
+	int count = 0;
+
+	int keyframe_slots = 0;
+	int next_keyframe = 0;
+	int current_keyframe = -1;
+	int records_since_keyframe = 0;
+
+	bool round_start_valid = false;
+	float round_start_time = 0.0f;
+};
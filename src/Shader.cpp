@@ -0,0 +1,95 @@
+#include "Shader.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+
+std::string ReadFile(const char* path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) throw std::runtime_error(std::string("Failed to open file: ") + path);
+
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+GLuint CompileShader(GLenum type, const std::string& src, const char* debugName)
+{
+    GLuint sh = glCreateShader(type);
+    const char* csrc = src.c_str();
+    glShaderSource(sh, 1, &csrc, nullptr);
+    glCompileShader(sh);
+
+    GLint ok = 0;
+    glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+    if (!ok)
+    {
+        GLint len = 0;
+        glGetShaderiv(sh, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetShaderInfoLog(sh, len, nullptr, log.data());
+        glDeleteShader(sh);
+        throw std::runtime_error(std::string("Shader compile failed (") + debugName + "):\n" + log);
+    }
+    return sh;
+}
+
+GLuint LinkProgram(GLuint vs, GLuint fs)
+{
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glLinkProgram(prog);
+
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        GLint len = 0;
+        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(prog, len, nullptr, log.data());
+        glDeleteProgram(prog);
+        throw std::runtime_error(std::string("Program link failed:\n") + log);
+    }
+
+
+    glDetachShader(prog, vs);
+    glDetachShader(prog, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    return prog;
+}
+
+GLuint LinkComputeProgram(GLuint cs, const char* debugName)
+{
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, cs);
+    glLinkProgram(prog);
+
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        GLint len = 0;
+        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(prog, len, nullptr, log.data());
+        glDeleteProgram(prog);
+        throw std::runtime_error(std::string("Program link failed (") + debugName + "):\n" + log);
+    }
+
+    glDetachShader(prog, cs);
+    glDeleteShader(cs);
+
+    return prog;
+}
+
+GLuint LoadComputeProgram(const char* name)
+{
+    const std::string path = std::string("shaders/") + name;
+    GLuint cs = CompileShader(GL_COMPUTE_SHADER, ReadFile(path.c_str()), name);
+    return LinkComputeProgram(cs, name);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include "glad/glad.h"
+
+std::string ReadFile(const char* path);
+GLuint CompileShader(GLenum type, const std::string& src, const char* debugName);
+GLuint LinkProgram(GLuint vs, GLuint fs);
+GLuint LinkComputeProgram(GLuint cs, const char* debugName);
+
+// Reads, compiles and links a compute shader from the shaders/ directory.
+GLuint LoadComputeProgram(const char* name);
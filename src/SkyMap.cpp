@@ -0,0 +1,58 @@
+#include "SkyMap.h"
+#include "Shader.h"
+
+static const GLuint WORKGROUP = 8;
+
+void SkyMap::release()
+{
+    if (program) glDeleteProgram(program);
+    if (texture) glDeleteTextures(1, &texture);
+    program = texture = 0;
+}
+
+void SkyMap::init()
+{
+    program = LoadComputeProgram("sky_bake.glsl");
+    u_face_size = glGetUniformLocation(program, "u_face_size");
+    u_layers = glGetUniformLocation(program, "u_layers");
+    u_star_density = glGetUniformLocation(program, "u_star_density");
+
+    int levels = 1;
+    for (int size = FACE_SIZE; size > 1; size /= 2) levels++;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, levels, GL_R11F_G11F_B10F, FACE_SIZE, FACE_SIZE, 6 * LAYERS);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    bake();
+}
+
+void SkyMap::bake()
+{
+    glUseProgram(program);
+    glUniform1i(u_face_size, FACE_SIZE);
+    glUniform1i(u_layers, LAYERS);
+    glUniform1f(u_star_density, star_density);
+
+    glBindImageTexture(0, texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+
+    GLuint groups = (FACE_SIZE + WORKGROUP - 1) / WORKGROUP;
+    glDispatchCompute(groups, groups, 6 * LAYERS);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP_ARRAY);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+}
+
+void SkyMap::bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "glad/glad.h"
+
+// The background starfield baked into a mipmapped cube map array instead of
+// being hashed per pixel. Faces are indexed by rd.xyz and the LAYERS slices of
+// rd.w each hold their own stars, so the sky changes as the camera turns
+// through the fourth dimension. Baked once at startup and again whenever the
+// star density changes.
+class SkyMap
+{
+public:
+	SkyMap() {};
+	~SkyMap() {};
+
+	void init();
+	void release();
+
+	// Rebakes every face and layer and rebuilds the mip chain.
+	void bake();
+
+	// Binds the map as a samplerCubeArray on the given texture unit.
+	void bind(GLuint unit) const;
+
+	float star_density = 0.012f;
+
+	static const int FACE_SIZE = 512;
+	static const int LAYERS = 4;
+
+private:
+	GLuint program = 0;
+	GLuint u_face_size = 0;
+	GLuint u_layers = 0;
+	GLuint u_star_density = 0;
+
+	GLuint texture = 0;
+};
@@ -1,9 +1,79 @@
-#include "Application.h"
+﻿#include "Application.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 
 using namespace std;
 
-int main()
+// The --out frame pattern reaches snprintf as the format, so it may hold exactly
+// one %d, optionally zero padded to a width as in %04d, plus %% for a literal %.
+static bool ValidFramePattern(const char* pattern)
+{
+	int conversions = 0;
+	for (const char* p = pattern; *p; p++)
+	{
+		if (*p != '%') continue;
+		if (p[1] == '%')
+		{
+			p++;
+			continue;
+		}
+
+		p++;
+		while (*p >= '0' && *p <= '9') p++;
+		if (*p != 'd') return false;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+// Kodor [--headless] [--size WxH] [--frames N] [--out frame.ppm | --out frame%04d.ppm] [--record run.y4m]
+static HeadlessSettings ParseArguments(int argc, char** argv)
+{
+	HeadlessSettings headless;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+
+		if (strcmp(argv[i], "--headless") == 0)
+			headless.enabled = true;
+		else if (strcmp(argv[i], "--size") == 0 && has_value)
+		{
+			if (sscanf(argv[++i], "%dx%d", &headless.width, &headless.height) != 2 || headless.width <= 0 || headless.height <= 0)
+				throw std::runtime_error("--size expects WIDTHxHEIGHT");
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && has_value)
+		{
+			if (sscanf(argv[++i], "%d", &headless.frames) != 1 || headless.frames <= 0)
+				throw std::runtime_error("--frames expects a positive count");
+		}
+		else if (strcmp(argv[i], "--out") == 0 && has_value)
+		{
+			headless.output = argv[++i];
+			if (headless.output.find('%') != string::npos && !ValidFramePattern(headless.output.c_str()))
+				throw std::runtime_error("--out takes a path, or a pattern with a single %d such as frame%04d.ppm");
+		}
+		else if (strcmp(argv[i], "--record") == 0 && has_value)
+			headless.record = argv[++i];
+		else
+			throw std::runtime_error(string("Unknown argument ") + argv[i]);
+	}
+
+	return headless;
+}
+
+int main(int argc, char** argv)
 {
-	Application app;
-	return app.run();
+	try
+	{
+		Application app(ParseArguments(argc, argv));
+		return app.run();
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
 }
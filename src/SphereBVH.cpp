@@ -0,0 +1,115 @@
+#include "SphereBVH.h"
+#include "Shader.h"
+
+#include <algorithm>
+
+static const GLuint WORKGROUP = 64;
+static const size_t NODE_BYTES = 48;
+
+static GLuint Groups(size_t n)
+{
+    return GLuint((n + WORKGROUP - 1) / WORKGROUP);
+}
+
+void SphereBVH::release()
+{
+    if (program) glDeleteProgram(program);
+    if (keySSBO) glDeleteBuffers(1, &keySSBO);
+    if (nodeSSBO) glDeleteBuffers(1, &nodeSSBO);
+    if (visitSSBO) glDeleteBuffers(1, &visitSSBO);
+    program = keySSBO = nodeSSBO = visitSSBO = 0;
+}
+
+void SphereBVH::init()
+{
+    program = LoadComputeProgram("bvh_build.glsl");
+    u_stage = glGetUniformLocation(program, "stage");
+    u_count = glGetUniformLocation(program, "count");
+    u_k = glGetUniformLocation(program, "k");
+    u_j = glGetUniformLocation(program, "j");
+
+    glGenBuffers(1, &keySSBO);
+    glGenBuffers(1, &nodeSSBO);
+    glGenBuffers(1, &visitSSBO);
+}
+
+void SphereBVH::allocate(size_t particle_count)
+{
+    this->particle_count = particle_count;
+
+    padded_count = 1;
+    while (padded_count < particle_count) padded_count *= 2;
+
+    size_t nodes = std::max<size_t>(1, 2 * particle_count);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, keySSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, padded_count * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, nodes * NODE_BYTES, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visitSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, particle_count) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    built = false;
+}
+
+void SphereBVH::update(GLuint particleSSBO)
+{
+    if (particle_count == 0) return;
+
+    glUseProgram(program);
+    glUniform1ui(u_count, GLuint(particle_count));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keySSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, nodeSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visitSSBO);
+
+    if (!built || ++updates_since_build >= REBUILD_INTERVAL)
+    {
+        build();
+        built = true;
+        updates_since_build = 0;
+    }
+
+    refit();
+}
+
+void SphereBVH::build()
+{
+    glUniform1i(u_stage, 0);
+    glDispatchCompute(Groups(padded_count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // bitonic sort of (code, index) pairs
+    glUniform1i(u_stage, 1);
+    for (GLuint k = 2; k <= padded_count; k *= 2)
+    {
+        for (GLuint j = k / 2; j > 0; j /= 2)
+        {
+            glUniform1ui(u_k, k);
+            glUniform1ui(u_j, j);
+            glDispatchCompute(Groups(padded_count), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+    }
+
+    glUniform1i(u_stage, 2);
+    glDispatchCompute(Groups(particle_count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void SphereBVH::refit()
+{
+    glUniform1i(u_stage, 3);
+    glDispatchCompute(Groups(particle_count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUniform1i(u_stage, 4);
+    glDispatchCompute(Groups(particle_count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void SphereBVH::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NODE_BINDING, nodeSSBO);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include "glad/glad.h"
+
+// Linear BVH over the particle balls, built on the GPU from 4D Morton codes of the
+// centers and refit bottom-up every frame. Bounds are balls in R^4, which the
+// marcher's chord distance measures directly. Motion slowly degrades the Morton
+// order, so the topology is rebuilt every REBUILD_INTERVAL updates. Every node
+// also carries its subtree's average color and summed area, which the marcher
+// draws in place of clusters too small on screen to resolve.
+class SphereBVH
+{
+public:
+	SphereBVH() {};
+	~SphereBVH() {};
+
+	void init();
+	void release();
+	void allocate(size_t particle_count);
+
+	// Refits the bounds to the current positions, rebuilding the topology first
+	// when it is due. Call after the physics step.
+	void update(GLuint particleSSBO);
+
+	// Binds the nodes at the binding frag.glsl reads them from.
+	void bind() const;
+
+	static const GLuint NODE_BINDING = 8;
+	static const int REBUILD_INTERVAL = 30;
+
+private:
+	void build();
+	void refit();
+
+	GLuint program = 0;
+	GLuint u_stage = 0;
+	GLuint u_count = 0;
+	GLuint u_k = 0;
+	GLuint u_j = 0;
+
+	GLuint keySSBO = 0;
+	GLuint nodeSSBO = 0;
+	GLuint visitSSBO = 0;
+
+	size_t particle_count = 0;
+	size_t padded_count = 0;
+	int updates_since_build = 0;
+	bool built = false;
+};
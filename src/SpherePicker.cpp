@@ -0,0 +1,132 @@
+#include "SpherePicker.h"
+
+// std430 layout of PickBuffer, the selected particle follows at PARTICLE_OFFSET
+struct PickGPU
+{
+    GLint pixel[2];
+    GLint radius;
+    GLuint key;
+};
+
+static const GLuint NO_HIT = 0xFFFFFFFFu;
+
+void SpherePicker::release()
+{
+    if (fence) glDeleteSync(fence);
+    if (pickSSBO) glDeleteBuffers(1, &pickSSBO);
+    fence = nullptr;
+    pickSSBO = 0;
+}
+
+void SpherePicker::init()
+{
+    PickGPU pick = { { -1, -1 }, PICK_RADIUS, NO_HIT };
+
+    glGenBuffers(1, &pickSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pickSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_OFFSET, &pick, GL_DYNAMIC_READ);
+}
+
+void SpherePicker::request(int x, int y)
+{
+    requested = true;
+    request_x = x;
+    request_y = y;
+}
+
+void SpherePicker::begin()
+{
+    // one readback in flight at a time, the request waits for the next frame
+    if (requested && !fence)
+    {
+        PickGPU pick = { { request_x, request_y }, PICK_RADIUS, NO_HIT };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pickSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(pick), &pick);
+
+        requested = false;
+        armed = true;
+        fence_pick = true;
+    }
+    else if (armed)
+    {
+        GLint off[2] = { -1, -1 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pickSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(off), off);
+        armed = false;
+    }
+}
+
+void SpherePicker::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PICK_BINDING, pickSSBO);
+}
+
+void SpherePicker::end(GLuint particleSSBO, size_t particle_size)
+{
+    if (fence) return;
+
+    if (particle_size != this->particle_size)
+    {
+        // room for the particle behind the pick block
+        this->particle_size = particle_size;
+        PickGPU pick = { { -1, -1 }, PICK_RADIUS, NO_HIT };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pickSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(PARTICLE_OFFSET + particle_size), nullptr, GL_DYNAMIC_READ);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(pick), &pick);
+        readback.assign(PARTICLE_OFFSET + particle_size, 0);
+        armed = false;
+        fence_pick = false;
+    }
+
+    if (selected_index >= 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, particleSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pickSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            GLintptr(selected_index * particle_size), GLintptr(PARTICLE_OFFSET), GLsizeiptr(particle_size));
+        fence_copy = selected_index;
+    }
+
+    if (fence_pick || fence_copy >= 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void SpherePicker::poll()
+{
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pickSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(readback.size()), readback.data());
+
+    if (fence_pick)
+    {
+        const PickGPU* pick = reinterpret_cast<const PickGPU*>(readback.data());
+        int index = pick->key == NO_HIT ? -1 : int(pick->key & ((1u << PICK_INDEX_BITS) - 1));
+        if (index != selected_index) has_particle = false;
+        selected_index = index;
+    }
+
+    // a copy made just before the selection changed is of the old sphere
+    if (fence_copy >= 0 && fence_copy == selected_index)
+        has_particle = true;
+
+    fence_pick = false;
+    fence_copy = -1;
+}
+
+void SpherePicker::clear()
+{
+    selected_index = -1;
+    has_particle = false;
+    fence_pick = false;
+    fence_copy = -1;
+}
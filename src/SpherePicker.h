@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "glad/glad.h"
+
+// Mouse picking without an ID pass. The marchers and the impostor shader already
+// know which sphere a pixel hit; while a pick is armed, hits within PICK_RADIUS of
+// the pick pixel atomicMin a key of quantized distance and particle index into a
+// small buffer. A fence a frame later hands back the nearest one. The selected
+// particle is copied out of the particle buffer behind the same fence, so its
+// properties can be shown live without ever stalling on the GPU.
+class SpherePicker
+{
+public:
+	SpherePicker() {};
+	~SpherePicker() {};
+
+	void init();
+	void release();
+
+	// Asks for the sphere under scene pixel (x, y), y up.
+	void request(int x, int y);
+
+	// Whether a request still needs a frame to be drawn.
+	bool pickPending() const { return requested; }
+
+	// Before the scene is drawn: arms a pending request, or disarms the last one.
+	void begin();
+
+	// Binds the pick buffer where the shaders read it, on every scene draw.
+	void bind() const;
+
+	// After the scene is drawn: copies the selected particle and fences the readback.
+	void end(GLuint particleSSBO, size_t particle_size);
+
+	// Reads back the last pick and the selected particle once the fence has passed.
+	void poll();
+
+	// Drops the selection, e.g. after the particles are replaced.
+	void clear();
+
+	int selected() const { return selected_index; }
+
+	// The selected particle as it was a frame or two ago, nullptr until it arrives.
+	const void* particle() const { return has_particle ? readback.data() + PARTICLE_OFFSET : nullptr; }
+
+	static const GLuint PICK_BINDING = 11;
+	static const int PICK_RADIUS = 2;         // pixels around the cursor, for tiny spheres
+	static const int PICK_INDEX_BITS = 20;    // must match the shaders
+	static const size_t PARTICLE_OFFSET = 16;
+
+private:
+	GLuint pickSSBO = 0;
+	size_t particle_size = 0;
+
+	bool requested = false;
+	int request_x = 0;
+	int request_y = 0;
+	bool armed = false;
+
+	GLsync fence = nullptr;
+	bool fence_pick = false;   // the fenced frame answers a pick
+	int fence_copy = -1;       // particle copied in the fenced frame
+
+	int selected_index = -1;
+	bool has_particle = false;
+	std::vector<unsigned char> readback;
+};
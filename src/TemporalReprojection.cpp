@@ -0,0 +1,91 @@
+#include "TemporalReprojection.h"
+#include "Shader.h"
+
+#include <cstring>
+
+void TemporalReprojection::release()
+{
+    if (program) glDeleteProgram(program);
+    if (vao) glDeleteVertexArrays(1, &vao);
+    program = vao = 0;
+
+    packed.release();
+    history[0].release();
+    history[1].release();
+}
+
+void TemporalReprojection::init()
+{
+    GLuint vs = CompileShader(GL_VERTEX_SHADER, ReadFile("shaders/vertex.glsl"), "vertex.glsl");
+    GLuint fs = CompileShader(GL_FRAGMENT_SHADER, ReadFile("shaders/temporal_resolve.glsl"), "temporal_resolve.glsl");
+    program = LinkProgram(vs, fs);
+
+    u_current = glGetUniformLocation(program, "u_current");
+    u_history = glGetUniformLocation(program, "u_history");
+    u_history_valid = glGetUniformLocation(program, "u_history_valid");
+    u_checker = glGetUniformLocation(program, "u_checker");
+    u_frame_index = glGetUniformLocation(program, "u_frame_index");
+    u_resolution = glGetUniformLocation(program, "u_resolution");
+    u_camera = glGetUniformLocation(program, "u_camera");
+    u_prev_camera = glGetUniformLocation(program, "u_prev_camera");
+
+    glGenVertexArrays(1, &vao);
+}
+
+void TemporalReprojection::resize(int width, int height)
+{
+    packed.resize(width, height);
+    if (history[0].resize(width, height) | history[1].resize(width, height))
+        history_valid = false;
+}
+
+void TemporalReprojection::begin(int scene_width, int scene_height, const float camera[16])
+{
+    if (scene_width != this->scene_width || scene_height != this->scene_height || pattern != last_pattern)
+        history_valid = false;
+
+    this->scene_width = scene_width;
+    this->scene_height = scene_height;
+    last_pattern = pattern;
+
+    std::memcpy(prev_camera, this->camera, sizeof(prev_camera));
+    std::memcpy(this->camera, camera, sizeof(this->camera));
+
+    frame_index++;
+
+    int packed_w = (scene_width + 1) / 2;
+    int packed_h = pattern == 1 ? scene_height : (scene_height + 1) / 2;
+
+    packed.bind(packed_w, packed_h);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void TemporalReprojection::resolve()
+{
+    int previous = current;
+    current = 1 - current;
+
+    history[current].bind(scene_width, scene_height);
+
+    glUseProgram(program);
+    glUniform1i(u_current, 0);
+    glUniform1i(u_history, 1);
+    glUniform1i(u_history_valid, history_valid ? 1 : 0);
+    glUniform1i(u_checker, pattern);
+    glUniform1i(u_frame_index, frame_index);
+    glUniform2f(u_resolution, float(scene_width), float(scene_height));
+    glUniformMatrix4fv(u_camera, 1, GL_FALSE, camera);
+    glUniformMatrix4fv(u_prev_camera, 1, GL_FALSE, prev_camera);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, packed.colorTexture());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, history[previous].colorTexture());
+    glActiveTexture(GL_TEXTURE0);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    history_valid = true;
+}
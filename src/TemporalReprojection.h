@@ -0,0 +1,59 @@
+#pragma once
+#include "glad/glad.h"
+#include "RenderTarget.h"
+
+// Checkerboard rendering for the sphere marcher. Each frame frag.glsl shades half
+// (or a quarter) of the pixels in a rotating pattern into a packed target, and a
+// resolve pass reprojects the previous frame through the 4D camera motion to fill
+// in the rest, using the hit distance the marcher leaves in alpha.
+class TemporalReprojection
+{
+public:
+	TemporalReprojection() {};
+	~TemporalReprojection() {};
+
+	void init();
+	void release();
+
+	// Storage follows the window, like the scene target.
+	void resize(int width, int height);
+
+	// Binds and clears the packed target for a scene of the given size.
+	// camera is this frame's column-major frame from Camera::frame_matrix.
+	void begin(int scene_width, int scene_height, const float camera[16]);
+
+	// Rebuilds the full scene image, afterwards output() holds it.
+	void resolve();
+
+	// Forgets the history, e.g. after a teleport or a mode change.
+	void invalidate() { history_valid = false; }
+
+	const RenderTarget& output() const { return history[current]; }
+
+	int pattern = 1;   // 1 half the pixels, 2 a quarter
+	int frameIndex() const { return frame_index; }
+
+private:
+	GLuint program = 0;
+	GLuint u_current = 0;
+	GLuint u_history = 0;
+	GLuint u_history_valid = 0;
+	GLuint u_checker = 0;
+	GLuint u_frame_index = 0;
+	GLuint u_resolution = 0;
+	GLuint u_camera = 0;
+	GLuint u_prev_camera = 0;
+	GLuint vao = 0;
+
+	RenderTarget packed;
+	RenderTarget history[2];
+	int current = 0;
+	bool history_valid = false;
+
+	int frame_index = 0;
+	int scene_width = 0;
+	int scene_height = 0;
+	int last_pattern = 0;
+	float camera[16] = {};
+	float prev_camera[16] = {};
+};
@@ -0,0 +1,64 @@
+#include "TileCuller.h"
+#include "Shader.h"
+
+static const GLuint WORKGROUP = 64;
+
+void TileCuller::release()
+{
+    if (program) glDeleteProgram(program);
+    if (countSSBO) glDeleteBuffers(1, &countSSBO);
+    if (listSSBO) glDeleteBuffers(1, &listSSBO);
+    program = countSSBO = listSSBO = 0;
+}
+
+void TileCuller::init()
+{
+    program = LoadComputeProgram("tile_cull.glsl");
+    u_camera = glGetUniformLocation(program, "u_camera");
+    u_resolution = glGetUniformLocation(program, "u_resolution");
+    u_tiles = glGetUniformLocation(program, "u_tiles");
+    u_tolerance = glGetUniformLocation(program, "u_tolerance");
+
+    glGenBuffers(1, &countSSBO);
+    glGenBuffers(1, &listSSBO);
+}
+
+void TileCuller::dispatch(GLuint particleSSBO, size_t particle_count, const float camera[16], int width, int height, float tolerance)
+{
+    tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t tiles = size_t(tiles_x) * size_t(tiles_y);
+
+    if (tiles > capacity)
+    {
+        capacity = tiles;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, countSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, listSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * MAX_PER_TILE * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, countSSBO);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    if (particle_count == 0) return;
+
+    glUseProgram(program);
+    glUniformMatrix4fv(u_camera, 1, GL_FALSE, camera);
+    glUniform2f(u_resolution, float(width), float(height));
+    glUniform2i(u_tiles, tiles_x, tiles_y);
+    glUniform1f(u_tolerance, tolerance);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleSSBO);
+    bind();
+
+    glDispatchCompute(GLuint((particle_count + WORKGROUP - 1) / WORKGROUP), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void TileCuller::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, countSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIST_BINDING, listSSBO);
+}
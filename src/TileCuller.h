@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include "glad/glad.h"
+
+// Bins every sphere into the screen tiles its view cone can touch, so the ray
+// marcher only visits the spheres of its own tile. A ball of geodesic radius r at
+// distance D subtends sin(a) = sin(r) / sin(D); great-circle rays also reach it
+// the long way round, so the antipodal direction is binned as well.
+class TileCuller
+{
+public:
+	TileCuller() {};
+	~TileCuller() {};
+
+	void init();
+	void release();
+
+	// camera is the column-major frame from Camera::frame_matrix, tolerance the
+	// marcher's hit threshold, which widens every sphere
+	void dispatch(GLuint particleSSBO, size_t particle_count, const float camera[16], int width, int height, float tolerance);
+
+	// Binds the tile counts and lists at the bindings frag.glsl reads them from.
+	void bind() const;
+
+	int tilesX() const { return tiles_x; }
+	int tilesY() const { return tiles_y; }
+
+	static const int TILE_SIZE = 16;
+	static const int MAX_PER_TILE = 128;   // fuller tiles fall back to the full scan
+	static const GLuint COUNT_BINDING = 4;
+	static const GLuint LIST_BINDING = 5;
+
+private:
+	GLuint program = 0;
+	GLuint u_camera = 0;
+	GLuint u_resolution = 0;
+	GLuint u_tiles = 0;
+	GLuint u_tolerance = 0;
+
+	GLuint countSSBO = 0;
+	GLuint listSSBO = 0;
+	size_t capacity = 0;
+
+	int tiles_x = 0;
+	int tiles_y = 0;
+};
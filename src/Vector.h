@@ -21,10 +21,10 @@ struct Vec3
 
 	static Vec3 from_spherical(float theta = 0.0, float phi = 0.0)
 	{
-		float ct = std::cosf(theta);
-		float st = std::sinf(theta);
-		float cp = std::cosf(phi);
-		float sp = std::sinf(phi);
+		float ct = std::cos(theta);
+		float st = std::sin(theta);
+		float cp = std::cos(phi);
+		float sp = std::sin(phi);
 
 
 
@@ -59,15 +59,15 @@ struct Vec3
 
 	Vec3& ApplyRotateTransformes(Vec3 orientation)
 	{
-		float cy = std::cosf(orientation.y); float sy = std::sinf(orientation.y);
+		float cy = std::cos(orientation.y); float sy = std::sin(orientation.y);
 		float new_x = x * cy - z * sy;
 		float new_z = x * sy + z * cy;
 
-		float cx = std::cosf(orientation.x); float sx = std::sinf(orientation.x);
+		float cx = std::cos(orientation.x); float sx = std::sin(orientation.x);
 		float new_y = y * cx - new_z * sx;
 		new_z = y * sx + new_z * cx;
 
-		float cz = std::cosf(orientation.z); float sz = std::sinf(orientation.z);
+		float cz = std::cos(orientation.z); float sz = std::sin(orientation.z);
 		float new_new_x = new_x * cz - new_y * sz;
 		new_y = new_x * sz + new_y * cz;
 
@@ -101,7 +101,7 @@ struct Vec3
 
 	float length() const
 	{
-		return std::sqrtf(this->length2());
+		return std::sqrt(this->length2());
 	}
 
 	Vec3 normalized() const
@@ -264,4 +264,64 @@ struct Vec4
 	Vec4& operator*=(float s) { *this = *this * s; return *this; }
 	Vec4& operator/=(float s) { *this = *this / s; return *this; }
 
-};
\ No newline at end of file
+};
+// Quaternion with the same layout as Vec4, w is the real part.
+// A point of S^3 read as a unit quaternion maps through v -> l * v * r for any
+// unit pair (l, r), which covers every rotation in SO(4).
+struct Quat
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 1.0f;
+
+	Quat() {}
+	Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	explicit Quat(const Vec4& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+	Vec4 vec() const { return Vec4(x, y, z, w); }
+
+	float dot(const Quat& o) const { return x * o.x + y * o.y + z * o.z + w * o.w; }
+
+	Quat normalized() const
+	{
+		float len = std::sqrt(dot(*this));
+		if (len == 0.0f) return Quat();
+		return Quat(x / len, y / len, z / len, w / len);
+	}
+
+	Quat operator*(const Quat& o) const
+	{
+		return Quat(
+			w * o.x + x * o.w + y * o.z - z * o.y,
+			w * o.y - x * o.z + y * o.w + z * o.x,
+			w * o.z + x * o.y - y * o.x + z * o.w,
+			w * o.w - x * o.x - y * o.y - z * o.z);
+	}
+
+	Quat operator-() const { return Quat(-x, -y, -z, -w); }
+
+	static Quat slerp(const Quat& a, const Quat& b, float t)
+	{
+		float c = a.dot(b);
+		if (c > 0.9995f)
+		{
+			return Quat(
+				a.x + (b.x - a.x) * t,
+				a.y + (b.y - a.y) * t,
+				a.z + (b.z - a.z) * t,
+				a.w + (b.w - a.w) * t).normalized();
+		}
+
+		float theta = std::acos(c < -1.0f ? -1.0f : c);
+		float s = std::sin(theta);
+		float wa = std::sin((1.0f - t) * theta) / s;
+		float wb = std::sin(t * theta) / s;
+
+		return Quat(
+			a.x * wa + b.x * wb,
+			a.y * wa + b.y * wb,
+			a.z * wa + b.z * wb,
+			a.w * wa + b.w * wb);
+	}
+};
@@ -0,0 +1,223 @@
+#version 430 core
+
+// Linear BVH over the sphere balls, run as dispatches selected by `stage`:
+// 0 Morton codes of the centers, 1 one bitonic merge step (k, j) on the codes,
+// 2 emit the hierarchy from the sorted codes (Karras 2012), 3 clear the refit
+// counters, 4 refit the bounds bottom-up.
+//
+// Nodes 0 .. n-2 are internal with node 0 the root, nodes n-1 .. 2n-2 are leaves.
+// Bounds are balls in R^4: the marcher's distance to a sphere is the chord, which
+// is the R^4 distance, so |p - center| - radius bounds everything below a node.
+// The refit also aggregates each subtree for level of detail: the color averaged
+// by area and the summed area r^2 of its spheres.
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+struct Node
+{
+    vec4 center;
+    float radius;
+    int left;      // child node, or the sphere index for a leaf
+    int right;     // child node, -1 for a leaf
+    int parent;
+    vec3 color;    // area weighted average color of the subtree
+    float area;    // sum of r^2 over the subtree
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) buffer KeyBuffer
+{
+    uvec2 keys[];   // (morton code, sphere index), padded to a power of two
+};
+
+layout(std430, binding = 2) coherent buffer NodeBuffer
+{
+    Node nodes[];
+};
+
+layout(std430, binding = 3) coherent buffer RefitBuffer
+{
+    uint visits[];
+};
+
+uniform int stage;
+uniform uint count;
+uniform uint k;
+uniform uint j;
+
+const uint PAD = 0xffffffffu;
+
+// spreads the low 8 bits of v to every fourth bit
+uint spread4(uint v)
+{
+    v &= 0xffu;
+    v = (v | (v << 12)) & 0x000f000fu;
+    v = (v | (v << 6)) & 0x03030303u;
+    v = (v | (v << 3)) & 0x11111111u;
+    return v;
+}
+
+uint morton4(vec4 p)
+{
+    uvec4 q = uvec4(clamp((p * 0.5 + 0.5) * 256.0, vec4(0.0), vec4(255.0)));
+    return (spread4(q.x) << 3) | (spread4(q.y) << 2) | (spread4(q.z) << 1) | spread4(q.w);
+}
+
+bool greaterKey(uvec2 a, uvec2 b)
+{
+    return a.x > b.x || (a.x == b.x && a.y > b.y);
+}
+
+// length of the common prefix of sorted keys i and j, the index breaks ties
+int delta(int i, int jj)
+{
+    if (jj < 0 || jj >= int(count)) return -1;
+
+    uint a = keys[i].x;
+    uint b = keys[jj].x;
+    if (a == b) return 32 + 31 - findMSB(uint(i ^ jj));
+    return 31 - findMSB(a ^ b);
+}
+
+void buildInternal(int i)
+{
+    int d = delta(i, i + 1) - delta(i, i - 1) >= 0 ? 1 : -1;
+
+    // upper bound on the range length, then binary search its other end
+    int d_min = delta(i, i - d);
+    int l_max = 2;
+    while (delta(i, i + l_max * d) > d_min) l_max *= 2;
+
+    int l = 0;
+    for (int t = l_max / 2; t >= 1; t /= 2)
+    {
+        if (delta(i, i + (l + t) * d) > d_min) l += t;
+    }
+    int jj = i + l * d;
+
+    // split position inside the range
+    int d_node = delta(i, jj);
+    int s = 0;
+    for (int div = 2; ; div *= 2)
+    {
+        int t = (l + div - 1) / div;
+        if (delta(i, i + (s + t) * d) > d_node) s += t;
+        if (t <= 1) break;
+    }
+    int gamma = i + s * d + min(d, 0);
+
+    int leaf_base = int(count) - 1;
+    int left = min(i, jj) == gamma ? leaf_base + gamma : gamma;
+    int right = max(i, jj) == gamma + 1 ? leaf_base + gamma + 1 : gamma + 1;
+
+    nodes[i].left = left;
+    nodes[i].right = right;
+    nodes[left].parent = i;
+    nodes[right].parent = i;
+}
+
+void mergeBalls(vec4 c1, float r1, vec4 c2, float r2, out vec4 c, out float r)
+{
+    vec4 d = c2 - c1;
+    float dist = length(d);
+
+    if (dist + r2 <= r1) { c = c1; r = r1; return; }
+    if (dist + r1 <= r2) { c = c2; r = r2; return; }
+
+    r = 0.5 * (dist + r1 + r2);
+    c = c1 + d * ((r - r1) / dist);
+
+    // keep the bound conservative under rounding
+    r += 1e-6;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (stage == 0)
+    {
+        if (id >= uint(keys.length())) return;
+
+        keys[id] = id < count ? uvec2(morton4(spheres[id].center), id) : uvec2(PAD, PAD);
+    }
+    else if (stage == 1)
+    {
+        uint partner = id ^ j;
+        if (id >= uint(keys.length()) || partner <= id) return;
+
+        uvec2 a = keys[id];
+        uvec2 b = keys[partner];
+        bool ascending = (id & k) == 0u;
+
+        if (greaterKey(a, b) == ascending)
+        {
+            keys[id] = b;
+            keys[partner] = a;
+        }
+    }
+    else if (stage == 2)
+    {
+        if (id >= count) return;
+
+        int leaf = int(count) - 1 + int(id);
+        nodes[leaf].left = int(keys[id].y);
+        nodes[leaf].right = -1;
+
+        if (id == 0u) nodes[0].parent = -1;
+        if (id + 1u < count) buildInternal(int(id));
+    }
+    else if (stage == 3)
+    {
+        if (id + 1u >= count) return;
+
+        visits[id] = 0u;
+    }
+    else
+    {
+        if (id >= count) return;
+
+        int node = int(count) - 1 + int(id);
+        Sphere s = spheres[nodes[node].left];
+        nodes[node].center = s.center;
+        nodes[node].radius = s.radius;
+        nodes[node].color = s.color;
+        nodes[node].area = s.radius * s.radius;
+
+        // the second child to arrive merges both into the parent
+        int parent = nodes[node].parent;
+        while (parent >= 0)
+        {
+            memoryBarrierBuffer();
+            if (atomicAdd(visits[parent], 1u) == 0u) return;
+
+            Node a = nodes[nodes[parent].left];
+            Node b = nodes[nodes[parent].right];
+
+            vec4 c;
+            float r;
+            mergeBalls(a.center, a.radius, b.center, b.radius, c, r);
+            nodes[parent].center = c;
+            nodes[parent].radius = r;
+
+            float area = a.area + b.area;
+            nodes[parent].color = area > 0.0 ? (a.color * a.area + b.color * b.area) / area : 0.5 * (a.color + b.color);
+            nodes[parent].area = area;
+
+            parent = nodes[parent].parent;
+        }
+    }
+}
@@ -8,6 +8,7 @@ struct Sphere
     vec3 color;
     float radius;
     vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
 };
 
 layout(std430, binding = 0) buffer SphereBuffer
@@ -0,0 +1,90 @@
+#version 430 core
+
+// Cone march of every 8x8 pixel bundle at 1/8 resolution. Rays of a bundle leave
+// the camera within angle a of the bundle's center ray, so at parameter t they are
+// within the chord w(t) = |sin t| 2 sin(a/2) of its point, and the center ray's
+// distance bound less w(t) bounds them all. Writes how far every ray of the bundle
+// can skip before the full resolution march starts.
+
+#define CONE_TILE 8
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(r32f, binding = 0) writeonly uniform image2D u_cone_start;
+
+uniform mat4 u_camera;
+uniform vec2 u_resolution;   // full resolution scene size
+uniform float u_tolerance;   // hit threshold of the marcher
+
+const float FOCAL = 2.0;        // must match frag.glsl
+const float MAX_DIST = 10.0;
+const int MAX_CONE_STEPS = 32;
+
+vec4 rayDirection(vec2 pixel)
+{
+    vec2 uv = (pixel / u_resolution * 2.0 - 1.0) * vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec4 rd = normalize(uv.x*u_camera[0] + uv.y*u_camera[1] + FOCAL*u_camera[2]);
+    return normalize(rd - u_camera[3]*dot(rd, u_camera[3]));
+}
+
+// chord distance to the nearest sphere surface, like sceneSDF in frag.glsl
+float sceneDistance(vec4 p)
+{
+    float d = MAX_DIST;
+    for (int i = 0; i < spheres.length(); i++)
+        d = min(d, sqrt(max(0.0, 2.0 - 2.0*dot(p, spheres[i].center))) - spheres[i].radius);
+    return d;
+}
+
+void main()
+{
+    ivec2 cell = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 lo = cell * CONE_TILE;
+    if (any(greaterThanEqual(lo, ivec2(u_resolution))))
+        return;
+
+    // centers of the bundle's corner pixels bound the cone, which is convex
+    vec2 first = vec2(lo) + 0.5;
+    vec2 last = vec2(lo + CONE_TILE - 1) + 0.5;
+    vec4 axis = rayDirection(0.5 * (first + last));
+
+    float cos_a = 1.0;
+    cos_a = min(cos_a, dot(axis, rayDirection(vec2(first.x, first.y))));
+    cos_a = min(cos_a, dot(axis, rayDirection(vec2(last.x, first.y))));
+    cos_a = min(cos_a, dot(axis, rayDirection(vec2(first.x, last.y))));
+    cos_a = min(cos_a, dot(axis, rayDirection(vec2(last.x, last.y))));
+
+    // chord between the axis and a ray at angle a, 2 sin(a/2)
+    float spread = sqrt(max(0.0, 2.0 - 2.0*cos_a));
+
+    vec4 cpos = u_camera[3];
+    float t = 0.0;
+
+    for (int i = 0; i < MAX_CONE_STEPS; i++)
+    {
+        vec4 p = cos(t)*cpos + sin(t)*axis;
+        float margin = sceneDistance(p) - abs(sin(t))*spread;
+        // the marcher already calls this close a hit
+        if (margin < u_tolerance) break;
+
+        // over a step s the axis point moves at most s and w(t) grows at most s spread
+        t += margin / (1.0 + spread);
+        if (t > MAX_DIST) break;
+    }
+
+    imageStore(u_cone_start, cell, vec4(min(t, MAX_DIST)));
+}
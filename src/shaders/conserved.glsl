@@ -0,0 +1,143 @@
+#version 430 core
+
+// Conserved quantities of the N-body system on S^3.
+// stage 0: per body kinetic energy, half its pair potential and m (p ^ v),
+//          tree-reduced per workgroup into `partials`
+// stage 1: one workgroup reduces the partials into `result`
+
+#define GROUP 256
+#define QUANTITIES 8
+
+layout(local_size_x = GROUP) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) buffer PartialBuffer
+{
+    float partials[];
+};
+
+layout(std430, binding = 2) buffer ResultBuffer
+{
+    float result[QUANTITIES];
+};
+
+uniform int stage;
+uniform uint partial_count;
+
+const float G = 35.5; // must match compute.glsl
+const float PI = 3.14159265359;
+
+shared float scratch[QUANTITIES][GROUP];
+shared vec4 tile[GROUP];
+shared float tile_mass[GROUP];
+
+float massOf(float r)
+{
+    return (4.0 / 3.0) * PI * r * r * r;
+}
+
+void reduceScratch(uint lid)
+{
+    for (uint stride = GROUP / 2; stride > 0u; stride >>= 1)
+    {
+        if (lid < stride)
+        {
+            for (int q = 0; q < QUANTITIES; q++)
+                scratch[q][lid] += scratch[q][lid + stride];
+        }
+        barrier();
+    }
+}
+
+void main()
+{
+    uint lid = gl_LocalInvocationID.x;
+    uint id = gl_GlobalInvocationID.x;
+
+    float values[QUANTITIES];
+    for (int q = 0; q < QUANTITIES; q++) values[q] = 0.0;
+
+    if (stage == 0)
+    {
+        uint n = spheres.length();
+        vec4 p = vec4(0.0);
+        float m = 0.0;
+
+        if (id < n)
+        {
+            p = spheres[id].center;
+            vec4 v = spheres[id].vel;
+            m = massOf(spheres[id].radius);
+
+            values[0] = 0.5 * m * dot(v, v);
+
+            values[2] = m * (p.x * v.y - p.y * v.x);
+            values[3] = m * (p.x * v.z - p.z * v.x);
+            values[4] = m * (p.x * v.w - p.w * v.x);
+            values[5] = m * (p.y * v.z - p.z * v.y);
+            values[6] = m * (p.y * v.w - p.w * v.y);
+            values[7] = m * (p.z * v.w - p.w * v.z);
+        }
+
+        // U = -G m_i m_j / r, each pair is seen from both ends so take half
+        for (uint base = 0u; base < n; base += GROUP)
+        {
+            uint j = base + lid;
+            tile[lid] = j < n ? spheres[j].center : vec4(0.0);
+            tile_mass[lid] = j < n ? massOf(spheres[j].radius) : 0.0;
+            barrier();
+
+            if (id < n)
+            {
+                uint count = min(uint(GROUP), n - base);
+                for (uint k = 0u; k < count; k++)
+                {
+                    if (base + k == id) continue;
+
+                    float r = acos(clamp(dot(p, tile[k]), -1.0, 1.0));
+                    if (r < 0.001) continue;
+
+                    values[1] -= 0.5 * G * m * tile_mass[k] / r;
+                }
+            }
+            barrier();
+        }
+    }
+    else
+    {
+        for (uint i = lid; i < partial_count; i += GROUP)
+        {
+            for (int q = 0; q < QUANTITIES; q++)
+                values[q] += partials[i * QUANTITIES + q];
+        }
+    }
+
+    for (int q = 0; q < QUANTITIES; q++) scratch[q][lid] = values[q];
+    barrier();
+
+    reduceScratch(lid);
+
+    if (lid == 0u)
+    {
+        for (int q = 0; q < QUANTITIES; q++)
+        {
+            if (stage == 0)
+                partials[gl_WorkGroupID.x * QUANTITIES + q] = scratch[q][0];
+            else
+                result[q] = scratch[q][0];
+        }
+    }
+}
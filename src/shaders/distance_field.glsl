@@ -0,0 +1,184 @@
+#version 430 core
+
+// Distance field over S^3 in Hopf coordinates
+//   p = (cos(eta) cos(xi1), cos(eta) sin(xi1), sin(eta) cos(xi2), sin(eta) sin(xi2))
+// with x = xi1, y = xi2, z = eta on the grid. Run as dispatches selected by `stage`:
+// 0 clear, 1 seed the cell of every sphere, 2 start the flood, 3 one jump flood
+// step of size `jump`, 4 resolve the flood into the field texture.
+//
+// Every occupied cell stands for one bounding ball around its center that holds
+// all of its spheres, so the flood only has to find the nearest of those.
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+struct Seed
+{
+    uint radius;   // float bits of the bounding radius, positive so uint max works
+    uint sphere;   // lowest sphere index in the cell, NONE when empty
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) buffer SeedBuffer
+{
+    Seed seeds[];
+};
+
+layout(std430, binding = 2) readonly buffer FloodIn
+{
+    int flood_in[];
+};
+
+layout(std430, binding = 3) writeonly buffer FloodOut
+{
+    int flood_out[];
+};
+
+layout(rg32f, binding = 0) uniform writeonly image3D field;
+
+uniform int stage;
+uniform int jump;
+uniform ivec3 dims;
+
+const uint NONE = 0xffffffffu;
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+const float FAR = 2.0;   // chord distance across S^3
+
+int cellCount()
+{
+    return dims.x * dims.y * dims.z;
+}
+
+int cellIndex(ivec3 c)
+{
+    return (c.z * dims.y + c.y) * dims.x + c.x;
+}
+
+ivec3 cellCoord(int i)
+{
+    return ivec3(i % dims.x, (i / dims.x) % dims.y, i / (dims.x * dims.y));
+}
+
+ivec3 hopfCell(vec4 p)
+{
+    float eta = atan(length(p.zw), length(p.xy));
+    float xi1 = atan(p.y, p.x);
+    float xi2 = atan(p.w, p.z);
+
+    vec3 uvw = vec3(mod(xi1, TWO_PI) / TWO_PI, mod(xi2, TWO_PI) / TWO_PI, eta / (0.5 * PI));
+    return clamp(ivec3(uvw * vec3(dims)), ivec3(0), dims - 1);
+}
+
+vec4 cellCenter(ivec3 c)
+{
+    vec3 uvw = (vec3(c) + 0.5) / vec3(dims);
+    float xi1 = uvw.x * TWO_PI;
+    float xi2 = uvw.y * TWO_PI;
+    float eta = uvw.z * 0.5 * PI;
+    return vec4(cos(eta) * vec2(cos(xi1), sin(xi1)), sin(eta) * vec2(cos(xi2), sin(xi2)));
+}
+
+float chord(vec4 a, vec4 b)
+{
+    return sqrt(max(0.0, 2.0 * (1.0 - dot(a, b))));
+}
+
+// distance from p to the bounding ball of seed cell s
+float seedDistance(vec4 p, int s)
+{
+    return chord(p, cellCenter(cellCoord(s))) - uintBitsToFloat(seeds[s].radius);
+}
+
+void main()
+{
+    int id = int(gl_GlobalInvocationID.x);
+
+    if (stage == 0)
+    {
+        if (id >= cellCount()) return;
+
+        seeds[id].radius = 0u;
+        seeds[id].sphere = NONE;
+    }
+    else if (stage == 1)
+    {
+        if (id >= spheres.length()) return;
+
+        vec4 c = spheres[id].center;
+        ivec3 cell = hopfCell(c);
+        int s = cellIndex(cell);
+
+        float bound = spheres[id].radius + chord(c, cellCenter(cell));
+        atomicMax(seeds[s].radius, floatBitsToUint(bound));
+        atomicMin(seeds[s].sphere, uint(id));
+    }
+    else if (stage == 2)
+    {
+        if (id >= cellCount()) return;
+
+        flood_out[id] = seeds[id].sphere != NONE ? id : -1;
+    }
+    else if (stage == 3)
+    {
+        if (id >= cellCount()) return;
+
+        ivec3 c = cellCoord(id);
+        vec4 p = cellCenter(c);
+
+        int best = flood_in[id];
+        float best_d = best >= 0 ? seedDistance(p, best) : 1e9;
+
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            // eta is clamped, both angles wrap around
+            int z = c.z + dz * jump;
+            if (z < 0 || z >= dims.z) continue;
+
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    ivec3 n = ivec3((c.x + dx * jump + dims.x) % dims.x, (c.y + dy * jump + dims.y) % dims.y, z);
+                    int s = flood_in[cellIndex(n)];
+                    if (s < 0 || s == best) continue;
+
+                    float d = seedDistance(p, s);
+                    if (d < best_d)
+                    {
+                        best = s;
+                        best_d = d;
+                    }
+                }
+            }
+        }
+
+        flood_out[id] = best;
+    }
+    else
+    {
+        if (id >= cellCount()) return;
+
+        ivec3 c = cellCoord(id);
+        int s = flood_in[id];
+
+        // distance at the cell center and the sphere it came from, -1 for none
+        vec2 value = vec2(FAR, -1.0);
+        if (s >= 0)
+            value = vec2(max(0.0, seedDistance(cellCenter(c), s)), float(seeds[s].sphere));
+
+        imageStore(field, c, vec4(value, 0.0, 0.0));
+    }
+}
@@ -1,16 +1,45 @@
 #version 460 core
 in vec2 screenPos;
-out vec4 FragColor;
+out vec4 FragColor;   // alpha is the hit distance t, -1 for sky, for reprojection
 
-const int MAX_STEPS = 20;
-const float TOLERANCE = 0.01;
+// march budget and hit threshold, lowered under load by the frame governor
+uniform int u_max_steps = 20;
+uniform float u_tolerance = 0.01;
 const float MAX_DIST= 10;
 
-uniform vec4 cpos;
-uniform vec4 up;
-uniform vec4 right;
-uniform vec4 front;
+// camera frame as columns: right, up, front, pos
+uniform mat4 u_camera;
 uniform float u_time;
+uniform vec2 u_resolution;
+
+// several cameras in one pass, from MultiView: each view's frame and the pixel
+// rectangle it fills, later views over earlier ones; with no views u_camera
+// fills the target
+#define MAX_VIEWS 4
+
+struct View
+{
+    mat4 camera;
+    vec4 rect;   // x, y, width, height in pixels
+};
+
+layout(std140, binding = 0) uniform ViewBlock {
+    View views[MAX_VIEWS];
+    int view_count;
+};
+
+// pixel size of the view being marched, u_resolution without views
+vec2 view_size;
+
+// checkerboard rendering: 0 every pixel, 1 half of them, 2 a quarter, packed into
+// a smaller target; temporal_resolve.glsl rebuilds the rest from the last frame
+uniform int u_checker = 0;
+uniform int u_frame_index = 0;
+
+vec4 cpos;
+vec4 up;
+vec4 right;
+vec4 front;
 
 float focal = 2;
 
@@ -20,12 +49,112 @@ struct Sphere
     vec3 color;
     float radius;
     vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
 };
 
 layout(std430, binding = 0) buffer ParticleBuffer {
     Sphere particles[];
 };
 
+// per-tile sphere lists written by tile_cull.glsl
+layout(std430, binding = 4) readonly buffer TileCounts {
+    uint tile_counts[];
+};
+
+layout(std430, binding = 5) readonly buffer TileLists {
+    uint tile_lists[];
+};
+
+#define TILE_SIZE 16
+#define MAX_PER_TILE 128
+
+uniform bool u_use_tiles;
+uniform ivec2 u_tiles;
+
+// 0 sphere tracing, 1 analytic great circle / ball intersection,
+// 2 background only, the spheres are rasterized as impostors on top
+uniform int u_render_mode;
+
+// Hopf coordinate distance field from distance_field.glsl: per cell the distance
+// to the nearest surface at the cell center, less the cell radius anywhere in it
+uniform bool u_use_field;
+uniform sampler3D u_field;
+uniform float u_field_cell_radius;
+
+const float FIELD_NEAR = 0.05;     // below this the spheres are evaluated exactly
+const int MAX_FIELD_STEPS = 32;
+
+// sphere hierarchy from bvh_build.glsl, node 0 is the root and right < 0 marks
+// a leaf whose left is the sphere index
+struct Node
+{
+    vec4 center;
+    float radius;
+    int left;
+    int right;
+    int parent;
+    vec3 color;    // area weighted average color of the subtree
+    float area;    // sum of r^2 over the subtree
+};
+
+layout(std430, binding = 8) readonly buffer NodeBuffer {
+    Node nodes[];
+};
+
+uniform bool u_use_bvh;
+
+// clusters narrower than this many pixels are drawn as their bounding cap, 0 never
+uniform float u_lod_pixels = 0.0;
+
+#define BVH_STACK 32
+
+// march seeding from MarchSeed: per pixel the empty distance found last frame, the
+// frame it was written in (as int bits) and the empty tube radius around it; read
+// from last frame's image, written to this one's
+layout(rgba32f, binding = 2) readonly uniform image2D u_seed_prev;
+layout(rgba32f, binding = 3) writeonly uniform image2D u_seed_next;
+
+// largest sphere motion since last frame, float bits, from seed_motion.glsl
+layout(std430, binding = 9) readonly buffer SeedMotion {
+    uint max_motion;
+};
+
+uniform bool u_use_seed;
+uniform int u_seed_frame;
+uniform float u_camera_shift;   // geodesic distance the camera moved since last frame
+uniform mat4 u_prev_camera;
+
+// distance every ray of an 8x8 pixel bundle can skip, from cone_prepass.glsl
+uniform bool u_use_cone;
+uniform sampler2D u_cone_start;
+
+#define CONE_TILE 8
+
+// candidate spheres of this pixel, the whole buffer unless a tile list is usable
+bool use_list = false;
+uint list_base = 0u;
+int candidate_count = 0;
+
+int candidate(int k)
+{
+    return use_list ? int(tile_lists[list_base + uint(k)]) : k;
+}
+
+
+ivec2 quarterOffset(int frame)
+{
+    const ivec2 o[4] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 1));
+    return o[frame & 3];
+}
+
+// full resolution pixel a packed checkerboard sample stands for
+ivec2 shadedPixel(ivec2 sub)
+{
+    if (u_checker == 1) return ivec2(2*sub.x + ((sub.y + u_frame_index) & 1), sub.y);
+    if (u_checker == 2) return 2*sub + quarterOffset(u_frame_index);
+    return sub;
+}
+
 
 float apcos(float t)
 {
@@ -38,15 +167,22 @@ struct Hit
     vec3 col;
     float t;
     vec4 center;
+    float alpha;   // below 1 for a cluster cap, the share of it its spheres cover
+    float radius;
+    int material;
+    int index;     // particle, -1 for a cluster cap
 };
 
 Hit sceneSDF(vec4 pos)
 {
     Hit hit;
     hit.t = 10.0;
+    hit.alpha = 1.0;
+    hit.material = -1;
 
-    for (int i = 0; i < particles.length(); i++)
+    for (int k = 0; k < candidate_count; k++)
     {
+        int i = candidate(k);
         float approx = 1.0 - dot(pos, particles[i].center);
         float coeff = dot(pos,pos-particles[i].center);
         if (approx > (hit.t + particles[i].radius))
@@ -63,7 +199,87 @@ Hit sceneSDF(vec4 pos)
             hit.t = d;
             hit.center = particles[i].center;
             hit.col = particles[i].color;
+            hit.radius = particles[i].radius;
+            hit.material = particles[i].material;
+            hit.index = i;
+        }
+    }
+    return hit;
+}
+
+// Screen diameter of a node's bound: a ball of chord radius R whose center is
+// the chord L = 2 sin(D/2) from the camera spans about 2 R / sin(D) radians.
+float clusterPixels(int node)
+{
+    float L = length(cpos - nodes[node].center);
+    float sin_d = L * sqrt(max(0.0, 1.0 - 0.25*L*L));
+    return focal * nodes[node].radius / max(sin_d, 1e-6) * view_size.y;
+}
+
+// Nearest surface through the hierarchy. Chord distance is the R^4 distance, so
+// |pos - center| - radius of a node bounds every sphere below it. Clusters below
+// u_lod_pixels on screen stop the descent and stand in as their bounding cap.
+Hit sceneBVH(vec4 pos)
+{
+    Hit hit;
+    hit.t = 10.0;
+    hit.alpha = 1.0;
+    hit.material = -1;
+
+    int stack[BVH_STACK];
+    int sp = 0;
+    stack[sp++] = 0;
+
+    while (sp > 0)
+    {
+        int node = stack[--sp];
+        float d_node = length(pos - nodes[node].center) - nodes[node].radius;
+        if (d_node >= hit.t)
+            continue;
+
+        if (nodes[node].right < 0)
+        {
+            int i = nodes[node].left;
+            float d = length(pos - particles[i].center) - particles[i].radius;
+            if (d < hit.t)
+            {
+                hit.t = d;
+                hit.center = particles[i].center;
+                hit.col = particles[i].color;
+                hit.alpha = 1.0;
+                hit.radius = particles[i].radius;
+                hit.material = particles[i].material;
+                hit.index = i;
+            }
+            continue;
+        }
+
+        if (u_lod_pixels > 0.0 && clusterPixels(node) < u_lod_pixels)
+        {
+            float R = nodes[node].radius;
+            hit.t = d_node;
+            hit.center = nodes[node].center;
+            hit.col = nodes[node].color;
+            hit.alpha = min(1.0, nodes[node].area / (R*R));
+            hit.radius = R;
+            hit.material = -1;
+            hit.index = -1;
+            continue;
         }
+
+        // a deeper tree than the stack: finish the query with the plain scan
+        if (sp + 2 > BVH_STACK)
+            return sceneSDF(pos);
+
+        // nearer child on top
+        int a = nodes[node].left;
+        int b = nodes[node].right;
+        float da = length(pos - nodes[a].center) - nodes[a].radius;
+        float db = length(pos - nodes[b].center) - nodes[b].radius;
+        if (da < db) { int tmp = a; a = b; b = tmp; }
+
+        stack[sp++] = a;
+        stack[sp++] = b;
     }
     return hit;
 }
@@ -74,6 +290,136 @@ vec4 marchOnSphere(vec4 origin, vec4 dir, float t)
     return cos(t)*origin + sin(t)*dir;
 }
 
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+
+float fieldBound(vec4 p)
+{
+    ivec3 dims = textureSize(u_field, 0);
+
+    float eta = atan(length(p.zw), length(p.xy));
+    float xi1 = atan(p.y, p.x);
+    float xi2 = atan(p.w, p.z);
+
+    vec3 uvw = vec3(mod(xi1, TWO_PI) / TWO_PI, mod(xi2, TWO_PI) / TWO_PI, eta / (0.25 * TWO_PI));
+    ivec3 cell = clamp(ivec3(uvw * vec3(dims)), ivec3(0), dims - 1);
+
+    return texelFetch(u_field, cell, 0).x - u_field_cell_radius;
+}
+
+// Every step of the march is an empty ball of radius sceneSDF around the ray, so up
+// to the first step shorter than 2 rho the ray is the axis of an empty tube of radius
+// rho. Each pixel stores the tube with its radius, sized from this frame's drift.
+const float SEED_TUBE_MIN = 0.005;
+const float SEED_TUBE_MAX = 0.1;
+const float SEED_TUBE_SCALE = 3.0;   // tube / drift: a seed can be passed on about twice
+
+float seed_tube = SEED_TUBE_MAX;
+
+// Radius still guaranteed around the stretch a seed skipped: last frame's tube
+// less this frame's drift. The tube stored for next frame is no wider.
+float seed_inherited = SEED_TUBE_MAX;
+
+// How far a point of this ray can be from the same point of last frame's rays
+// around it, counting the motion of the spheres: the camera motion and the spread
+// of neighbouring rays are chord distances and so independent of t.
+float seedDrift()
+{
+    float pixel_angle = 2.0 / (focal * u_resolution.y);
+    return 2.5 * u_camera_shift + 2.2 * pixel_angle + uintBitsToFloat(max_motion);
+}
+
+// Distance along rd known to be empty from last frame: the shortest stored tube in
+// the 3x3 pixels around where the previous camera saw this direction, provided the
+// drift and the hit tolerance fit inside the narrowest of them.
+float marchSeed(vec4 rd, float drift, out float radius)
+{
+    radius = 0.0;
+
+    vec3 local = vec3(dot(rd, u_prev_camera[0]), dot(rd, u_prev_camera[1]), dot(rd, u_prev_camera[2]));
+    if (local.z <= 1e-4) return 0.0;
+
+    vec2 uv = focal * local.xy / local.z / vec2(u_resolution.x / u_resolution.y, 1.0);
+    ivec2 center = ivec2(floor((uv * 0.5 + 0.5) * u_resolution));
+
+    float t_free = MAX_DIST;
+    bool found = false;
+    radius = SEED_TUBE_MAX;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            vec4 s = imageLoad(u_seed_prev, center + ivec2(x, y));
+            if (floatBitsToInt(s.y) != u_seed_frame - 1) continue;
+
+            t_free = min(t_free, s.x);
+            radius = min(radius, s.z);
+            found = true;
+        }
+    }
+    // the marcher calls a ray within u_tolerance of a sphere a hit, keep those
+    return found && drift + u_tolerance < radius ? t_free : 0.0;
+}
+
+// t_clear is where the march first stepped less than 2 seed_tube, or where it
+// stopped; the tube ends seed_tube before it
+void storeSeed(ivec2 pixel, float t_clear)
+{
+    if (u_use_seed)
+    {
+        float t = clamp(t_clear - seed_tube, 0.0, MAX_DIST);
+        float radius = min(seed_tube, seed_inherited);
+        imageStore(u_seed_next, pixel, vec4(t, intBitsToFloat(u_seed_frame), radius, 0.0));
+    }
+}
+
+// Exact first hit of the great circle cos(t) o + sin(t) d with the candidate balls.
+// Along the ray dot(p, c) = A cos(t - phi), the ball is dot(p, c) >= cos R where
+// the chord radius r gives cos R = 1 - r^2/2, so the entry is phi - acos(cos R / A).
+bool intersectScene(vec4 o, vec4 d, out float t_hit, out Hit hit)
+{
+    t_hit = TWO_PI;
+    bool found = false;
+
+    for (int k = 0; k < candidate_count; k++)
+    {
+        int i = candidate(k);
+        vec4 c = particles[i].center;
+        float r = particles[i].radius;
+
+        float a = dot(o, c);
+        float b = dot(d, c);
+        float cosR = 1.0 - 0.5*r*r;
+
+        float t;
+        if (a >= cosR)
+        {
+            t = 0.0;
+        }
+        else
+        {
+            float A = sqrt(a*a + b*b);
+            if (A < cosR) continue;
+
+            t = mod(atan(b, a) - acos(cosR / A), TWO_PI);
+        }
+
+        if (t < t_hit)
+        {
+            t_hit = t;
+            hit.t = 0.0;
+            hit.center = c;
+            hit.col = particles[i].color;
+            hit.alpha = 1.0;
+            hit.radius = r;
+            hit.material = particles[i].material;
+            hit.index = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
 vec4 normalS3(vec4 p, vec4 c)
 {
     vec4 n = c - p*dot(p,c);      
@@ -81,73 +427,222 @@ vec4 normalS3(vec4 p, vec4 c)
     return normalize(n);
 }
 
+// Mouse picking, armed by SpherePicker: hits within pick_radius of pick_pixel
+// keep the nearest sphere, quantized distance above the particle index.
+layout(std430, binding = 11) buffer PickBuffer {
+    ivec2 pick_pixel;   // x < 0 when no pick is armed
+    int pick_radius;
+    uint pick_key;
+};
+
+#define PICK_INDEX_BITS 20
 
-float hash3(vec3 p)
+void pick(ivec2 pixel, float t, int index)
 {
-    return fract(sin(dot(p, vec3(127.1,311.7,74.7))) * 43758.5453);
+    if (pick_pixel.x < 0 || index < 0 || index >= (1 << PICK_INDEX_BITS)) return;
+    if (any(greaterThan(abs(pixel - pick_pixel), ivec2(pick_radius)))) return;
+
+    uint depth = uint(clamp(t / MAX_DIST, 0.0, 1.0) * 4095.0);
+    atomicMin(pick_key, (depth << PICK_INDEX_BITS) | uint(index));
 }
 
-vec3 sky(vec4 rd)
+// Sphere textures streamed in by MaterialLibrary. The surface of a ball is a
+// 2-sphere around its center c; directions from c are taken in the tangent frame
+// c*i, c*j, c*k and mapped to longitude and latitude.
+uniform sampler2DArray u_materials;
+uniform uint u_material_ready;   // a bit per layer, the rest keep the flat color
+
+#define MATERIAL_SIZE 512
+
+vec3 surfaceColor(Hit hit, vec4 p)
 {
-    vec3 d = normalize(rd.xyz);
+    if (hit.material < 0 || (u_material_ready & (1u << uint(hit.material))) == 0u)
+        return hit.col;
+
+    vec4 c = hit.center;
+    vec4 u = p - c*dot(p, c);
+    vec3 local = normalize(vec3(
+        dot(u, vec4(c.w, c.z, -c.y, -c.x)),
+        dot(u, vec4(-c.z, c.w, c.x, -c.y)),
+        dot(u, vec4(c.y, -c.x, c.w, -c.z))));
+    vec2 uv = vec2(atan(local.z, local.x) / TWO_PI + 0.5, acos(clamp(local.y, -1.0, 1.0)) / PI);
+
+    // a pixel covers sin(t) times its angle at distance t; texels span pi r / size
+    float cos_t = dot(p, cpos);
+    float footprint = 2.0 / (focal * view_size.y) * sqrt(max(0.0, 1.0 - cos_t*cos_t));
+    float lod = log2(max(footprint * float(MATERIAL_SIZE) / (PI * hit.radius), 1.0));
+
+    return textureLod(u_materials, vec3(uv, float(hit.material)), lod).rgb;
+}
 
-    float scale = 140.0;
-    vec3 cell = floor(d*scale);
-    vec3 local = fract(d*scale) - 0.5;
+vec4 shade(Hit hit, vec4 p)
+{
+    vec4 n = normalS3(p, hit.center);
+    vec4 lightDir = normalize(front - cpos*dot(front,cpos));
 
-    float rnd = hash3(cell);
+    float diff = max(dot(n,lightDir),0.0);
+    float ambient = 0.18;
 
-    vec3 col = vec3(0.01,0.015,0.03); 
+    return vec4(surfaceColor(hit, p)*(ambient + diff),1.0);
+}
 
-    if(rnd < 0.012)
-    {
-        vec3 offset = vec3(
-            fract(rnd*13.1),
-            fract(rnd*7.7),
-            fract(rnd*19.3)
-        ) - 0.5;
 
-        float dist = length(local - offset);
-        float glow = exp(-1.0*dist);
+// Starfield baked by sky_bake.glsl: faces by rd.xyz, SKY_LAYERS slices of rd.w
+uniform samplerCubeArray u_sky;
 
-        float brightness = 0.7 + 2.0*fract(rnd*50.0);
-        col += vec3(1.0,0.95,0.9)*glow*brightness;
-    }
+#define SKY_LAYERS 4
+#define SKY_FACE_SIZE 512
+
+vec3 sky(vec4 rd)
+{
+    float r = length(rd.xyz);
+    vec3 d = rd.xyz / max(r, 1e-6);
+
+    // explicit lod, the march leaves derivatives undefined; a pixel spans
+    // pixel_angle on S^3 but pixel_angle / r once rd.xyz is normalized
+    float pixel_angle = 2.0 / (focal * view_size.y);
+    float texel_angle = 2.0 / float(SKY_FACE_SIZE);
+    float lod = max(0.0, log2(pixel_angle / (max(r, 1e-3) * texel_angle)));
 
-  
-    float band = exp(-6.0*abs(d.y));
-    col += vec3(0.15,0.18,0.25)*band*0.4;
+    float layer = (rd.w * 0.5 + 0.5) * float(SKY_LAYERS - 1);
+    float base = min(floor(layer), float(SKY_LAYERS - 2));
 
-    return col;
+    vec3 a = textureLod(u_sky, vec4(d, base), lod).rgb;
+    vec3 b = textureLod(u_sky, vec4(d, base + 1.0), lod).rgb;
+    return mix(a, b, clamp(layer - base, 0.0, 1.0));
 }
 
 
 void main()
 {
+    ivec2 pixel = shadedPixel(ivec2(gl_FragCoord.xy));
+    vec2 ray_uv = screenPos;
+    if (u_checker != 0)
+        ray_uv = ((vec2(pixel) + 0.5) / u_resolution * 2.0 - 1.0) * vec2(u_resolution.x / u_resolution.y, 1.0);
+
+    mat4 camera = u_camera;
+    view_size = u_resolution;
+    for (int v = view_count - 1; v >= 0; v--)
+    {
+        vec4 rect = views[v].rect;
+        vec2 local = vec2(pixel) + 0.5 - rect.xy;
+        if (all(greaterThanEqual(local, vec2(0.0))) && all(lessThan(local, rect.zw)))
+        {
+            camera = views[v].camera;
+            view_size = rect.zw;
+            ray_uv = (local / rect.zw * 2.0 - 1.0) * vec2(rect.z / rect.w, 1.0);
+            break;
+        }
+    }
 
-    vec4 rd = normalize(screenPos.x*right + screenPos.y*up + focal*front);
-    rd = normalize(rd - cpos*dot(rd,cpos));
+    right = camera[0];
+    up = camera[1];
+    front = camera[2];
+    cpos = camera[3];
 
-    vec4 p = cpos;
-    float t = 0.0;
+    candidate_count = particles.length();
+    if (u_use_tiles)
+    {
+        ivec2 tile = min(pixel / TILE_SIZE, u_tiles - 1);
+        uint index = uint(tile.y * u_tiles.x + tile.x);
+        uint count = tile_counts[index];
+
+        if (count <= MAX_PER_TILE)
+        {
+            use_list = true;
+            list_base = index * MAX_PER_TILE;
+            candidate_count = int(count);
+        }
+    }
+
+    vec4 rd = normalize(ray_uv.x*right + ray_uv.y*up + focal*front);
+    rd = normalize(rd - cpos*dot(rd,cpos));
 
     Hit hit;
 
-    for(int i=0;i<MAX_STEPS;i++)
+    if (u_render_mode == 2)
     {
-        hit = sceneSDF(p);
+        FragColor = vec4(sky(rd),-1.0);
+        return;
+    }
 
-        if(hit.t < TOLERANCE)
+    if (u_render_mode == 1)
+    {
+        float t_hit;
+        if (intersectScene(cpos, rd, t_hit, hit))
         {
-            p = marchOnSphere(cpos, rd, t);
+            pick(pixel, t_hit, hit.index);
+            FragColor = vec4(shade(hit, marchOnSphere(cpos, rd, t_hit)).rgb, t_hit);
+        }
+        else
+            FragColor = vec4(sky(rd),-1.0);
+        return;
+    }
+
+    float t = u_use_cone ? texelFetch(u_cone_start, pixel / CONE_TILE, 0).x : 0.0;
+    if (u_use_seed)
+    {
+        // next frame should drift about as much as this one
+        float drift = seedDrift();
+        seed_tube = clamp(SEED_TUBE_SCALE * drift, SEED_TUBE_MIN, SEED_TUBE_MAX);
+
+        // the cone only proves the bundle empty, not a tube around it
+        if (t > 0.0) seed_inherited = 0.0;
+
+        float radius;
+        float t_seed = marchSeed(rd, drift, radius);
+        if (t_seed > t)
+        {
+            t = t_seed;
+            seed_inherited = radius - drift;
+        }
+    }
+    vec4 p = marchOnSphere(cpos, rd, t);
+    bool seeded = t > 0.0;
+    float t_clear = -1.0;
+
+    for(int i=0;i<u_max_steps;i++)
+    {
+        // cheap conservative steps through empty space
+        if (u_use_field)
+        {
+            for (int j = 0; j < MAX_FIELD_STEPS; j++)
+            {
+                float bound = fieldBound(p);
+                if (bound < FIELD_NEAR || t > MAX_DIST) break;
+                if (t_clear < 0.0 && bound < 2.0 * seed_tube) t_clear = t;
+
+                t += bound;
+                p = marchOnSphere(cpos, rd, t);
+            }
+            if (t > MAX_DIST) break;
+        }
+
+        hit = u_use_bvh ? sceneBVH(p) : sceneSDF(p);
+
+        // the seed overshot into a sphere that moved in: march again from the camera
+        if (seeded && hit.t < -u_tolerance)
+        {
+            seeded = false;
+            t = 0.0;
+            t_clear = -1.0;
+            seed_inherited = SEED_TUBE_MAX;
+            p = cpos;
+            continue;
+        }
 
-            vec4 n = normalS3(p, hit.center);
-            vec4 lightDir = normalize(front - cpos*dot(front,cpos));
+        if (t_clear < 0.0 && hit.t < 2.0 * seed_tube) t_clear = t;
 
-            float diff = max(dot(n,lightDir),0.0);
-            float ambient = 0.18;
+        if(hit.t < u_tolerance)
+        {
+            p = marchOnSphere(cpos, rd, t);
+            storeSeed(pixel, t_clear);
+            pick(pixel, t, hit.index);
 
-            FragColor = vec4(hit.col*(ambient + diff),1.0);
+            // a cluster cap lets the sky through where its spheres leave gaps
+            vec3 color = shade(hit, p).rgb;
+            if (hit.alpha < 1.0) color = mix(sky(rd), color, hit.alpha);
+            FragColor = vec4(color, t);
             return;
         }
 
@@ -158,5 +653,6 @@ void main()
     }
 
     // miss ? sky
-    FragColor = vec4(sky(rd),1.0);
+    storeSeed(pixel, t_clear < 0.0 ? t : t_clear);
+    FragColor = vec4(sky(rd),-1.0);
 }
@@ -0,0 +1,256 @@
+#version 430 core
+
+// Friends-of-friends on S^3, run as seven dispatches selected by `stage`:
+// 0 reset labels and the grid, 1 bin bodies into a hashed grid of R^4 cells one
+// linking chord wide, 2 link pairs closer than the linking length from the 3^4
+// cells around each body, 3 flatten labels and accumulate per-root sums, 4 count
+// the groups into a histogram of their masses, 5 find the lightest mass bin that
+// still fits the list from the top (a single invocation), 6 emit the groups in
+// that bin or above.
+
+layout(local_size_x = 64) in;
+
+const uint MASS_BINS = 256u;   // eight per octave of the fixed point mass
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+struct Accum
+{
+    uint count;
+    uint mass;      // fixed point, mass_fx units
+    int center[4];  // mass weighted position, fixed point
+    uint pad0;
+    uint pad1;
+};
+
+struct Cluster
+{
+    vec4 center;
+    float mass;
+    uint count;
+    uint root;
+    uint pad;
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) coherent buffer ParentBuffer
+{
+    uint parent[];
+};
+
+layout(std430, binding = 2) buffer AccumBuffer
+{
+    Accum accum[];
+};
+
+layout(std430, binding = 3) buffer SummaryBuffer
+{
+    uint cluster_count;
+    uint grouped_particles;
+    uint grouped_mass;
+    uint reported;
+    uint min_bin;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+    uint histogram[MASS_BINS];
+    Cluster clusters[];
+};
+
+// bucket heads of the hash table, then one next link per body
+layout(std430, binding = 4) buffer GridBuffer
+{
+    uint grid[];
+};
+
+uniform int stage;
+uniform float link_cos;
+uniform uint min_members;
+uniform float cell_size;   // at least the chord of the linking length
+uniform uint table_mask;   // hash table size - 1, a power of two
+uniform float mass_fx;     // fixed point units per unit of mass, sized to the population
+
+const float PI = 3.14159265359;
+const uint EMPTY = 0xFFFFFFFFu;
+
+ivec4 cellOf(vec4 p)
+{
+    return ivec4(floor((p + 1.0) / cell_size));
+}
+
+uint bucketOf(ivec4 cell)
+{
+    uvec4 c = uvec4(cell);
+    return ((c.x * 73856093u) ^ (c.y * 19349663u) ^ (c.z * 83492791u) ^ (c.w * 2654435761u)) & table_mask;
+}
+
+float massOf(uint i)
+{
+    float r = spheres[i].radius;
+    return (4.0 / 3.0) * PI * r * r * r;
+}
+
+uint massBin(uint mass)
+{
+    return uint(clamp(log2(float(mass)) * 8.0, 0.0, float(MASS_BINS - 1u)));
+}
+
+// a root of a group large enough to report
+bool isGroup(uint id)
+{
+    return parent[id] == id && accum[id].count >= min_members;
+}
+
+uint findRoot(uint x)
+{
+    uint p = parent[x];
+    while (p != x)
+    {
+        x = p;
+        p = parent[x];
+    }
+    return x;
+}
+
+// lock-free union: always hook the larger root under the smaller one
+void unite(uint a, uint b)
+{
+    while (true)
+    {
+        a = findRoot(a);
+        b = findRoot(b);
+        if (a == b) return;
+
+        if (a < b) { uint t = a; a = b; b = t; }
+
+        if (atomicCompSwap(parent[a], a, b) == a) return;
+    }
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    uint n = spheres.length();
+
+    if (stage == 0)
+    {
+        // dispatched over the larger of the table and the bodies
+        if (id <= table_mask) grid[id] = EMPTY;
+        if (id < MASS_BINS) histogram[id] = 0u;
+        if (id >= n) return;
+
+        parent[id] = id;
+        accum[id].count = 0u;
+        accum[id].mass = 0u;
+        for (int k = 0; k < 4; k++) accum[id].center[k] = 0;
+
+        if (id == 0u)
+        {
+            cluster_count = 0u;
+            grouped_particles = 0u;
+            grouped_mass = 0u;
+            reported = 0u;
+        }
+    }
+    else if (stage == 1)
+    {
+        if (id >= n) return;
+
+        uint bucket = bucketOf(cellOf(spheres[id].center));
+        grid[table_mask + 1u + id] = atomicExchange(grid[bucket], id);
+    }
+    else if (stage == 2)
+    {
+        if (id >= n) return;
+
+        // friends are at most one cell apart on every axis; hash collisions only
+        // add candidates, the distance test stays exact
+        vec4 p = spheres[id].center;
+        ivec4 cell = cellOf(p);
+
+        for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dw = -1; dw <= 1; dw++)
+        {
+            uint other = grid[bucketOf(cell + ivec4(dx, dy, dz, dw))];
+            while (other != EMPTY)
+            {
+                if (other > id && dot(p, spheres[other].center) >= link_cos)
+                    unite(id, other);
+                other = grid[table_mask + 1u + other];
+            }
+        }
+    }
+    else if (stage == 3)
+    {
+        if (id >= n) return;
+
+        uint root = findRoot(id);
+        parent[id] = root;
+
+        float m = massOf(id);
+        vec4 weighted = spheres[id].center * m;
+
+        atomicAdd(accum[root].count, 1u);
+        // rounded, so the quantization does not bias the sums low
+        atomicAdd(accum[root].mass, uint(m * mass_fx + 0.5));
+        for (int k = 0; k < 4; k++)
+            atomicAdd(accum[root].center[k], int(round(weighted[k] * mass_fx)));
+    }
+    else if (stage == 4)
+    {
+        if (id >= n || !isGroup(id)) return;
+
+        Accum a = accum[id];
+        atomicAdd(cluster_count, 1u);
+        atomicAdd(grouped_particles, a.count);
+        atomicAdd(grouped_mass, a.mass);
+        atomicAdd(histogram[massBin(a.mass)], 1u);
+    }
+    else if (stage == 5)
+    {
+        if (id != 0u) return;
+
+        // whole bins from the heaviest down, the one that would overflow the list
+        // is left out, so the list is always the heaviest groups
+        uint room = uint(clusters.length());
+        uint taken = 0u;
+        min_bin = MASS_BINS;
+        for (uint b = MASS_BINS; b > 0u; b--)
+        {
+            if (taken + histogram[b - 1u] > room) break;
+            taken += histogram[b - 1u];
+            min_bin = b - 1u;
+        }
+    }
+    else
+    {
+        if (id >= n || !isGroup(id)) return;
+
+        Accum a = accum[id];
+        if (massBin(a.mass) < min_bin) return;
+
+        uint slot = atomicAdd(reported, 1u);
+        if (slot >= uint(clusters.length())) return;
+
+        vec4 c = vec4(a.center[0], a.center[1], a.center[2], a.center[3]);
+        c = dot(c, c) > 0.0 ? normalize(c) : spheres[id].center;
+
+        clusters[slot].center = c;
+        clusters[slot].mass = float(a.mass) / mass_fx;
+        clusters[slot].count = a.count;
+        clusters[slot].root = id;
+    }
+}
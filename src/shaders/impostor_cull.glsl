@@ -0,0 +1,194 @@
+#version 430 core
+
+// Projects every ball stereographically from the camera's antipode and appends a
+// screen rectangle for each of its two images (the ball itself and, the long way
+// round the great circle, its antipode) to the impostor instance list. Images
+// narrower than u_splat_below pixels are counted, and with u_splat appended to the
+// point splat list instead.
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+struct Impostor
+{
+    vec4 rect;     // ndc min.xy, max.xy
+    float depth;   // nearest possible t of this image, as a depth value
+    uint sphere;
+    uint pad0;
+    uint pad1;
+};
+
+struct Splat
+{
+    vec4 position;   // ndc xy, depth, point size in pixels
+    vec4 color;      // rgb already weighted by coverage and distance
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 6) writeonly buffer ImpostorBuffer
+{
+    Impostor impostors[];
+};
+
+layout(std430, binding = 10) writeonly buffer SplatBuffer
+{
+    Splat splats[];
+};
+
+// DrawArraysIndirectCommand for the impostor quads, then one for the splat
+// points, then the count of sub-pixel images
+layout(std430, binding = 7) buffer CommandBuffer
+{
+    uint vertex_count;
+    uint instance_count;
+    uint first_vertex;
+    uint base_instance;
+
+    uint splat_count;
+    uint splat_instance_count;
+    uint splat_first_vertex;
+    uint splat_base_instance;
+
+    uint subpixel_count;
+};
+
+uniform mat4 u_camera;
+uniform vec2 u_resolution;
+uniform float u_splat_below;   // projected diameter in pixels, 0 counts nothing
+uniform bool u_splat;
+
+const float FOCAL = 2.0;   // must match frag.glsl
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+const float HALF_PI = 1.57079632679;
+const float BIG = 1e6;
+const float DEPTH_SLACK = 1e-3;
+
+const float SPLAT_SIZE = 2.0;                 // point footprint in pixels
+const float SPLAT_SHADE = 0.18 + 2.0 / 3.0;   // ambient plus the disk average of the headlight
+const float SPLAT_FOG = 0.15;                 // per unit of t, fades far images
+
+// Slope range x/z covered by a ball of radius R around c in the (x, z) plane.
+bool axisBounds(float cx, float cz, float R, out float lo, out float hi)
+{
+    float L2 = cx * cx + cz * cz;
+    if (L2 <= R * R)
+    {
+        lo = -BIG;
+        hi = BIG;
+        return true;
+    }
+
+    float phi = atan(cx, cz);
+    float delta = asin(R / sqrt(L2));
+    float a0 = phi - delta;
+    float a1 = phi + delta;
+
+    if (a0 >= HALF_PI || a1 <= -HALF_PI) return false;
+
+    lo = a0 <= -HALF_PI ? -BIG : tan(a0);
+    hi = a1 >= HALF_PI ? BIG : tan(a1);
+    return true;
+}
+
+void emit(uint id, vec4 rect, float t_near)
+{
+    uint slot = atomicAdd(instance_count, 1u);
+    impostors[slot].rect = rect;
+    impostors[slot].depth = max(t_near - DEPTH_SLACK, 0.0) / TWO_PI;
+    impostors[slot].sphere = id;
+}
+
+// A sub-pixel image as one additive point: the ball's share of a pixel's area
+// times its average shade, fading with the distance along the ray.
+void emitSplat(uint id, vec2 ndc, float pixels, float t_near)
+{
+    float coverage = 0.25 * PI * pixels * pixels;
+    float weight = coverage * SPLAT_SHADE * exp(-SPLAT_FOG * t_near);
+
+    uint slot = atomicAdd(splat_count, 1u);
+    splats[slot].position = vec4(ndc, t_near / TWO_PI, SPLAT_SIZE);
+    splats[slot].color = vec4(spheres[id].color * weight, 0.0);
+}
+
+// The image of a ball at distance D with geodesic radius rho along `axis` spans
+// s = 2 tan(theta / 2) for theta in [D - rho, D + rho], a round ball in R^3.
+void project(uint id, vec3 axis, float D, float rho, float t_offset)
+{
+    float s1 = 2.0 * tan(0.5 * (D - rho));
+    float s2 = 2.0 * tan(0.5 * (D + rho));
+    vec3 c = axis * (0.5 * (s1 + s2));
+    float R = 0.5 * (s2 - s1);
+
+    // screenPos spans 2 over the height
+    float pixels = FOCAL * 2.0 * R / max(c.z, 1e-6) * 0.5 * u_resolution.y;
+    if (c.z > R && pixels < u_splat_below)
+    {
+        vec2 ndc = FOCAL * c.xy / c.z / vec2(u_resolution.x / u_resolution.y, 1.0);
+        if (any(greaterThan(abs(ndc), vec2(1.0) + 2.0 * SPLAT_SIZE / u_resolution))) return;
+
+        atomicAdd(subpixel_count, 1u);
+        if (u_splat)
+        {
+            emitSplat(id, ndc, pixels, t_offset + D);
+            return;
+        }
+    }
+
+    vec2 lo, hi;
+    if (!axisBounds(c.x, c.z, R, lo.x, hi.x)) return;
+    if (!axisBounds(c.y, c.z, R, lo.y, hi.y)) return;
+
+    // slope -> screenPos -> ndc, one pixel of slack for the rasterizer
+    vec2 scale = vec2(FOCAL) / vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec2 pad = 2.0 / u_resolution;
+    vec2 n_lo = max(lo * scale - pad, vec2(-1.0));
+    vec2 n_hi = min(hi * scale + pad, vec2(1.0));
+
+    if (any(greaterThanEqual(n_lo, n_hi))) return;
+
+    emit(id, vec4(n_lo, n_hi), t_offset + D - rho);
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    vec4 c = spheres[id].center;
+
+    float cw = dot(c, u_camera[3]);
+    vec3 u = vec3(dot(c, u_camera[0]), dot(c, u_camera[1]), dot(c, u_camera[2]));
+    float s = length(u);
+    float D = atan(s, cw);
+
+    // radius is a chord, as in the marcher
+    float rho = 2.0 * asin(min(0.5 * spheres[id].radius, 1.0));
+
+    // camera inside the ball, or the ball contains the antipode and projects to
+    // the outside of a sphere: cover the screen, the fragment test is exact anyway
+    if (D <= rho || D + rho >= PI)
+    {
+        emit(id, vec4(-1.0, -1.0, 1.0, 1.0), 0.0);
+        return;
+    }
+
+    vec3 axis = u / s;
+
+    project(id, axis, D, rho, 0.0);
+    project(id, -axis, PI - D, rho, PI);
+}
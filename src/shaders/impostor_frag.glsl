@@ -0,0 +1,127 @@
+#version 460 core
+
+// Exact great-circle hit against a single ball, t is written as depth so
+// overlapping impostors resolve in the depth buffer.
+
+in vec2 ndc;
+flat in uint sphere;
+flat in float near_depth;
+out vec4 FragColor;
+
+layout(depth_greater) out float gl_FragDepth;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer ParticleBuffer {
+    Sphere particles[];
+};
+
+// camera frame as columns: right, up, front, pos
+uniform mat4 u_camera;
+uniform vec2 u_resolution;
+uniform sampler2DArray u_materials;
+uniform uint u_material_ready;
+
+const float focal = 2;
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+
+#define MATERIAL_SIZE 512
+
+vec4 normalS3(vec4 p, vec4 c)
+{
+    vec4 n = c - p*dot(p,c);
+    n = n - p*dot(n,p);
+    return normalize(n);
+}
+
+// same picking as frag.glsl
+layout(std430, binding = 11) buffer PickBuffer {
+    ivec2 pick_pixel;   // x < 0 when no pick is armed
+    int pick_radius;
+    uint pick_key;
+};
+
+#define PICK_INDEX_BITS 20
+
+void pick(ivec2 pixel, float t, int index)
+{
+    if (pick_pixel.x < 0 || index < 0 || index >= (1 << PICK_INDEX_BITS)) return;
+    if (any(greaterThan(abs(pixel - pick_pixel), ivec2(pick_radius)))) return;
+
+    uint depth = uint(clamp(t / TWO_PI, 0.0, 1.0) * 4095.0);
+    atomicMin(pick_key, (depth << PICK_INDEX_BITS) | uint(index));
+}
+
+// same mapping as frag.glsl
+vec3 surfaceColor(vec4 p, vec4 cpos)
+{
+    int material = particles[sphere].material;
+    if (material < 0 || (u_material_ready & (1u << uint(material))) == 0u)
+        return particles[sphere].color;
+
+    vec4 c = particles[sphere].center;
+    vec4 u = p - c*dot(p, c);
+    vec3 local = normalize(vec3(
+        dot(u, vec4(c.w, c.z, -c.y, -c.x)),
+        dot(u, vec4(-c.z, c.w, c.x, -c.y)),
+        dot(u, vec4(c.y, -c.x, c.w, -c.z))));
+    vec2 uv = vec2(atan(local.z, local.x) / TWO_PI + 0.5, acos(clamp(local.y, -1.0, 1.0)) / PI);
+
+    float cos_t = dot(p, cpos);
+    float footprint = 2.0 / (focal * u_resolution.y) * sqrt(max(0.0, 1.0 - cos_t*cos_t));
+    float lod = log2(max(footprint * float(MATERIAL_SIZE) / (PI * particles[sphere].radius), 1.0));
+
+    return textureLod(u_materials, vec3(uv, float(material)), lod).rgb;
+}
+
+void main()
+{
+    vec4 right = u_camera[0];
+    vec4 up = u_camera[1];
+    vec4 front = u_camera[2];
+    vec4 cpos = u_camera[3];
+
+    // same ray as frag.glsl
+    vec2 screenPos = ndc * vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec4 rd = normalize(screenPos.x*right + screenPos.y*up + focal*front);
+    rd = normalize(rd - cpos*dot(rd,cpos));
+
+    vec4 c = particles[sphere].center;
+    float r = particles[sphere].radius;
+
+    float a = dot(cpos, c);
+    float b = dot(rd, c);
+    float cosR = 1.0 - 0.5*r*r;
+
+    float t = 0.0;
+    if (a < cosR)
+    {
+        float A = sqrt(a*a + b*b);
+        if (A < cosR) discard;
+
+        t = mod(atan(b, a) - acos(cosR / A), TWO_PI);
+    }
+
+    // the nearer image of this ball is drawn by its own impostor
+    float depth = t / TWO_PI;
+    if (depth < near_depth) discard;
+
+    vec4 p = cos(t)*cpos + sin(t)*rd;
+    vec4 n = normalS3(p, c);
+    vec4 lightDir = normalize(front - cpos*dot(front,cpos));
+
+    float diff = max(dot(n,lightDir),0.0);
+    float ambient = 0.18;
+
+    pick(ivec2(gl_FragCoord.xy), t, int(sphere));
+    FragColor = vec4(surfaceColor(p, cpos)*(ambient + diff),1.0);
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,35 @@
+#version 460 core
+
+// One screen-aligned quad per impostor written by impostor_cull.glsl.
+
+struct Impostor
+{
+    vec4 rect;
+    float depth;
+    uint sphere;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, binding = 6) readonly buffer ImpostorBuffer
+{
+    Impostor impostors[];
+};
+
+out vec2 ndc;
+flat out uint sphere;
+flat out float near_depth;
+
+void main()
+{
+    Impostor imp = impostors[gl_InstanceID];
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    ndc = mix(imp.rect.xy, imp.rect.zw, corner);
+    sphere = imp.sphere;
+    near_depth = imp.depth;
+
+    // the quad sits at the nearest depth the ball can have, so the conservative
+    // depth in the fragment shader keeps early depth rejection
+    gl_Position = vec4(ndc, imp.depth * 2.0 - 1.0, 1.0);
+}
@@ -0,0 +1,361 @@
+#version 460 core
+
+// Compute version of the sphere tracing path of frag.glsl. One workgroup marches
+// an 8x8 pixel block: its candidate spheres (the cull tile's list, or the whole
+// buffer) are streamed through shared memory in chunks of 64, every lane tests
+// its own ray against the chunk and only the spheres some ray of the block comes
+// within hit range of are kept for the march. With USE_SUBGROUPS, injected by
+// ComputeMarcher when the driver has GL_KHR_shader_subgroup, the lanes' masks are
+// combined per subgroup before they reach shared memory.
+
+#ifdef USE_SUBGROUPS
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
+#define BLOCK 8
+#define CHUNK 64             // BLOCK * BLOCK, one sphere per lane per chunk
+#define SHARED_SPHERES 256   // more survivors fall back to the unculled list
+#define TILE_SIZE 16         // must match tile_cull.glsl
+#define MAX_PER_TILE 128
+#define CONE_TILE 8
+#define SKY_LAYERS 4
+#define SKY_FACE_SIZE 512
+#define MATERIAL_SIZE 512
+
+layout(local_size_x = BLOCK, local_size_y = BLOCK) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer ParticleBuffer {
+    Sphere particles[];
+};
+
+layout(std430, binding = 4) readonly buffer TileCounts {
+    uint tile_counts[];
+};
+
+layout(std430, binding = 5) readonly buffer TileLists {
+    uint tile_lists[];
+};
+
+layout(rgba16f, binding = 0) writeonly uniform image2D u_target;
+
+uniform mat4 u_camera;
+uniform vec2 u_resolution;
+uniform int u_max_steps;
+uniform float u_tolerance;
+uniform ivec2 u_tiles;        // 0 x 0 without tile lists
+uniform bool u_use_cone;
+uniform sampler2D u_cone_start;
+uniform samplerCubeArray u_sky;
+uniform sampler2DArray u_materials;
+uniform uint u_material_ready;
+
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+
+const float FOCAL = 2.0;      // must match frag.glsl
+const float MAX_DIST = 10.0;
+
+// this chunk of candidates, one loaded per lane
+shared vec4 chunk_center[CHUNK];
+shared vec4 chunk_color[CHUNK];   // rgb color, a radius
+shared int chunk_material[CHUNK];
+shared int chunk_index[CHUNK];
+shared uvec2 chunk_needed;
+
+// the block's spheres
+shared vec4 block_center[SHARED_SPHERES];
+shared vec4 block_color[SHARED_SPHERES];
+shared int block_material[SHARED_SPHERES];
+shared int block_index[SHARED_SPHERES];
+shared uint block_count;
+
+bool use_list = false;
+uint list_base = 0u;
+
+int candidate(uint k)
+{
+    return use_list ? int(tile_lists[list_base + k]) : int(k);
+}
+
+struct Hit
+{
+    vec3 col;
+    float t;
+    vec4 center;
+    float radius;
+    int material;
+    int index;
+};
+
+// sceneSDF of frag.glsl over the block's spheres, or over every candidate when
+// they did not fit
+Hit sceneSDF(vec4 pos, bool overflow, uint candidate_count)
+{
+    Hit hit;
+    hit.t = 10.0;
+
+    uint count = overflow ? candidate_count : block_count;
+    for (uint k = 0u; k < count; k++)
+    {
+        vec4 c;
+        vec4 color;
+        int material;
+        int index;
+        if (overflow)
+        {
+            index = candidate(k);
+            c = particles[index].center;
+            color = vec4(particles[index].color, particles[index].radius);
+            material = particles[index].material;
+        }
+        else
+        {
+            c = block_center[k];
+            color = block_color[k];
+            material = block_material[k];
+            index = block_index[k];
+        }
+
+        float approx = 1.0 - dot(pos, c);
+        if (approx > hit.t + color.a)
+            continue;
+
+        float d = sqrt(max(0.0, 2.0*approx)) - color.a;
+        if (d < hit.t)
+        {
+            hit.t = d;
+            hit.center = c;
+            hit.col = color.rgb;
+            hit.radius = color.a;
+            hit.material = material;
+            hit.index = index;
+        }
+    }
+    return hit;
+}
+
+// Whether the great circle cos(t) o + sin(t) d ever comes within the hit
+// tolerance of the ball. MAX_DIST exceeds 2 pi, so the whole circle counts: along
+// it dot(p, c) peaks at sqrt(a^2 + b^2), the test of intersectScene in frag.glsl.
+bool rayNeeds(vec4 o, vec4 d, vec4 c, float r)
+{
+    float a = dot(o, c);
+    float b = dot(d, c);
+    float reach = r + u_tolerance;
+    float cosR = 1.0 - 0.5*reach*reach;
+    return cosR <= 0.0 || a*a + b*b >= cosR*cosR;
+}
+
+vec4 marchOnSphere(vec4 origin, vec4 dir, float t)
+{
+    return cos(t)*origin + sin(t)*dir;
+}
+
+vec4 normalS3(vec4 p, vec4 c)
+{
+    vec4 n = c - p*dot(p,c);
+    n = n - p*dot(n,p);
+    return normalize(n);
+}
+
+// same picking as frag.glsl
+layout(std430, binding = 11) buffer PickBuffer {
+    ivec2 pick_pixel;   // x < 0 when no pick is armed
+    int pick_radius;
+    uint pick_key;
+};
+
+#define PICK_INDEX_BITS 20
+
+void pick(ivec2 pixel, float t, int index)
+{
+    if (pick_pixel.x < 0 || index < 0 || index >= (1 << PICK_INDEX_BITS)) return;
+    if (any(greaterThan(abs(pixel - pick_pixel), ivec2(pick_radius)))) return;
+
+    uint depth = uint(clamp(t / MAX_DIST, 0.0, 1.0) * 4095.0);
+    atomicMin(pick_key, (depth << PICK_INDEX_BITS) | uint(index));
+}
+
+// same mapping as frag.glsl
+vec3 surfaceColor(Hit hit, vec4 p)
+{
+    if (hit.material < 0 || (u_material_ready & (1u << uint(hit.material))) == 0u)
+        return hit.col;
+
+    vec4 c = hit.center;
+    vec4 u = p - c*dot(p, c);
+    vec3 local = normalize(vec3(
+        dot(u, vec4(c.w, c.z, -c.y, -c.x)),
+        dot(u, vec4(-c.z, c.w, c.x, -c.y)),
+        dot(u, vec4(c.y, -c.x, c.w, -c.z))));
+    vec2 uv = vec2(atan(local.z, local.x) / TWO_PI + 0.5, acos(clamp(local.y, -1.0, 1.0)) / PI);
+
+    float cos_t = dot(p, u_camera[3]);
+    float footprint = 2.0 / (FOCAL * u_resolution.y) * sqrt(max(0.0, 1.0 - cos_t*cos_t));
+    float lod = log2(max(footprint * float(MATERIAL_SIZE) / (PI * hit.radius), 1.0));
+
+    return textureLod(u_materials, vec3(uv, float(hit.material)), lod).rgb;
+}
+
+vec4 shade(Hit hit, vec4 p)
+{
+    vec4 cpos = u_camera[3];
+    vec4 front = u_camera[2];
+    vec4 n = normalS3(p, hit.center);
+    vec4 lightDir = normalize(front - cpos*dot(front,cpos));
+
+    float diff = max(dot(n,lightDir),0.0);
+    float ambient = 0.18;
+
+    return vec4(surfaceColor(hit, p)*(ambient + diff),1.0);
+}
+
+// same lookup as frag.glsl
+vec3 sky(vec4 rd)
+{
+    float r = length(rd.xyz);
+    vec3 d = rd.xyz / max(r, 1e-6);
+
+    float pixel_angle = 2.0 / (FOCAL * u_resolution.y);
+    float texel_angle = 2.0 / float(SKY_FACE_SIZE);
+    float lod = max(0.0, log2(pixel_angle / (max(r, 1e-3) * texel_angle)));
+
+    float layer = (rd.w * 0.5 + 0.5) * float(SKY_LAYERS - 1);
+    float base = min(floor(layer), float(SKY_LAYERS - 2));
+
+    vec3 a = textureLod(u_sky, vec4(d, base), lod).rgb;
+    vec3 b = textureLod(u_sky, vec4(d, base + 1.0), lod).rgb;
+    return mix(a, b, clamp(layer - base, 0.0, 1.0));
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    uint lane = gl_LocalInvocationIndex;
+    bool inside = all(lessThan(pixel, ivec2(u_resolution)));
+
+    vec4 cpos = u_camera[3];
+    vec2 uv = ((vec2(pixel) + 0.5) / u_resolution * 2.0 - 1.0) * vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec4 rd = normalize(uv.x*u_camera[0] + uv.y*u_camera[1] + FOCAL*u_camera[2]);
+    rd = normalize(rd - cpos*dot(rd, cpos));
+
+    // a block lies in a single cull tile, so every lane agrees on the list
+    uint candidate_count = uint(particles.length());
+    if (u_tiles.x > 0)
+    {
+        ivec2 tile = min(ivec2(gl_WorkGroupID.xy) * BLOCK / TILE_SIZE, u_tiles - 1);
+        uint index = uint(tile.y * u_tiles.x + tile.x);
+        uint count = tile_counts[index];
+
+        if (count <= MAX_PER_TILE)
+        {
+            use_list = true;
+            list_base = index * MAX_PER_TILE;
+            candidate_count = count;
+        }
+    }
+
+    if (lane == 0u)
+    {
+        block_count = 0u;
+        chunk_needed = uvec2(0u);
+    }
+    barrier();
+
+    for (uint base = 0u; base < candidate_count; base += CHUNK)
+    {
+        uint n = min(uint(CHUNK), candidate_count - base);
+        if (lane < n)
+        {
+            int i = candidate(base + lane);
+            chunk_center[lane] = particles[i].center;
+            chunk_color[lane] = vec4(particles[i].color, particles[i].radius);
+            chunk_material[lane] = particles[i].material;
+            chunk_index[lane] = i;
+        }
+        barrier();
+
+        uvec2 needed = uvec2(0u);
+        if (inside)
+        {
+            for (uint j = 0u; j < n; j++)
+            {
+                if (rayNeeds(cpos, rd, chunk_center[j], chunk_color[j].a))
+                    needed[j >> 5] |= 1u << (j & 31u);
+            }
+        }
+
+#ifdef USE_SUBGROUPS
+        needed = subgroupOr(needed);
+        if (subgroupElect() && any(notEqual(needed, uvec2(0u))))
+#else
+        if (any(notEqual(needed, uvec2(0u))))
+#endif
+        {
+            atomicOr(chunk_needed.x, needed.x);
+            atomicOr(chunk_needed.y, needed.y);
+        }
+        barrier();
+
+        // pack the needed spheres behind the ones kept so far, in chunk order
+        uvec2 mask = chunk_needed;
+        if (lane < n && (mask[lane >> 5] & (1u << (lane & 31u))) != 0u)
+        {
+            uint below = lane < 32u
+                ? bitCount(mask.x & ((1u << lane) - 1u))
+                : bitCount(mask.x) + bitCount(mask.y & ((1u << (lane - 32u)) - 1u));
+            uint slot = block_count + below;
+            if (slot < SHARED_SPHERES)
+            {
+                block_center[slot] = chunk_center[lane];
+                block_color[slot] = chunk_color[lane];
+                block_material[slot] = chunk_material[lane];
+                block_index[slot] = chunk_index[lane];
+            }
+        }
+        barrier();
+
+        if (lane == 0u)
+        {
+            block_count += bitCount(mask.x) + bitCount(mask.y);
+            chunk_needed = uvec2(0u);
+        }
+        barrier();
+    }
+
+    if (!inside) return;
+
+    bool overflow = block_count > SHARED_SPHERES;
+
+    float t = u_use_cone ? texelFetch(u_cone_start, pixel / CONE_TILE, 0).x : 0.0;
+    vec4 p = marchOnSphere(cpos, rd, t);
+
+    for (int i = 0; i < u_max_steps; i++)
+    {
+        Hit hit = sceneSDF(p, overflow, candidate_count);
+
+        if (hit.t < u_tolerance)
+        {
+            pick(pixel, t, hit.index);
+            imageStore(u_target, pixel, vec4(shade(hit, p).rgb, t));
+            return;
+        }
+
+        t += hit.t;
+        if (t > MAX_DIST) break;
+
+        p = marchOnSphere(cpos, rd, t);
+    }
+
+    imageStore(u_target, pixel, vec4(sky(rd), -1.0));
+}
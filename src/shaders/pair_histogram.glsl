@@ -0,0 +1,110 @@
+#version 430 core
+
+// Histogram of pairwise geodesic distances over [0, PI]. Each workgroup counts
+// into shared memory and flushes once. Exact mode walks all pairs i < j through
+// shared memory tiles, sampled mode draws `samples` random partners per body.
+
+#define TILE 64
+#define BINS 256
+
+layout(local_size_x = TILE) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) buffer HistogramBuffer
+{
+    uint histogram[BINS];
+};
+
+uniform bool sampled;
+uniform uint samples;
+uniform uint seed;
+
+const float PI = 3.14159265359;
+
+shared uint local_hist[BINS];
+shared vec4 tile[TILE];
+
+uint binOf(float d)
+{
+    float r = acos(clamp(d, -1.0, 1.0));
+    return min(uint(r * (float(BINS) / PI)), uint(BINS - 1));
+}
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+void main()
+{
+    uint lid = gl_LocalInvocationID.x;
+    uint id = gl_GlobalInvocationID.x;
+    uint n = spheres.length();
+
+    for (uint b = lid; b < BINS; b += TILE)
+        local_hist[b] = 0u;
+    barrier();
+
+    vec4 p = id < n ? spheres[id].center : vec4(0.0);
+
+    if (sampled)
+    {
+        if (id < n)
+        {
+            uint state = hash(id * 0x9e3779b9u + seed);
+            for (uint s = 0u; s < samples; s++)
+            {
+                state = hash(state);
+                uint j = state % n;
+                if (j == id) continue;
+                atomicAdd(local_hist[binOf(dot(p, spheres[j].center))], 1u);
+            }
+        }
+    }
+    else
+    {
+        for (uint base = 0u; base < n; base += TILE)
+        {
+            uint j = base + lid;
+            tile[lid] = j < n ? spheres[j].center : vec4(0.0);
+            barrier();
+
+            if (id < n && base + TILE > id + 1u)
+            {
+                uint count = min(uint(TILE), n - base);
+                for (uint k = 0u; k < count; k++)
+                {
+                    if (base + k > id)
+                        atomicAdd(local_hist[binOf(dot(p, tile[k]))], 1u);
+                }
+            }
+            barrier();
+        }
+    }
+
+    barrier();
+
+    for (uint b = lid; b < BINS; b += TILE)
+    {
+        if (local_hist[b] != 0u)
+            atomicAdd(histogram[b], local_hist[b]);
+    }
+}
@@ -0,0 +1,51 @@
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) readonly buffer KeyframeBuffer
+{
+    Sphere keyframes[];
+};
+
+layout(std430, binding = 2) readonly buffer DeltaBuffer
+{
+    uvec4 deltas[];
+};
+
+uniform uint key_base;
+uniform uint delta_base;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    Sphere key = keyframes[key_base + id];
+    uvec4 d = deltas[delta_base + id];
+
+    vec4 p = key.center + vec4(unpackHalf2x16(d.x), unpackHalf2x16(d.y));
+    vec4 v = key.vel + vec4(unpackHalf2x16(d.z), unpackHalf2x16(d.w));
+
+    // half precision pulls the state slightly off S^3, put it back
+    p = normalize(p);
+    v -= p * dot(p, v);
+
+    spheres[id].center = p;
+    spheres[id].vel = v;
+}
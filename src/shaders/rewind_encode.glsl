@@ -0,0 +1,48 @@
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) readonly buffer KeyframeBuffer
+{
+    Sphere keyframes[];
+};
+
+// half-float position and velocity deltas against the keyframe
+layout(std430, binding = 2) writeonly buffer DeltaBuffer
+{
+    uvec4 deltas[];
+};
+
+uniform uint key_base;
+uniform uint delta_base;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    Sphere key = keyframes[key_base + id];
+
+    vec4 dp = spheres[id].center - key.center;
+    vec4 dv = spheres[id].vel - key.vel;
+
+    deltas[delta_base + id] = uvec4(
+        packHalf2x16(dp.xy), packHalf2x16(dp.zw),
+        packHalf2x16(dv.xy), packHalf2x16(dv.zw));
+}
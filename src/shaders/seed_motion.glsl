@@ -0,0 +1,51 @@
+#version 430 core
+
+// Largest geodesic distance any sphere moved since the last frame, for the march
+// seed in frag.glsl. Each sphere compares its center with the copy kept from the
+// last frame, then refreshes that copy.
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 1) buffer PreviousCenters
+{
+    vec4 previous[];
+};
+
+// float bits, non negative floats order like their bits; cleared to 0 every frame
+layout(std430, binding = 9) buffer SeedMotion
+{
+    uint max_motion;
+};
+
+uniform bool u_valid;   // false when previous[] holds nothing usable yet
+
+const float NO_HISTORY = 1e6;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    vec4 c = spheres[id].center;
+
+    float moved = u_valid ? acos(clamp(dot(c, previous[id]), -1.0, 1.0)) : NO_HISTORY;
+    atomicMax(max_motion, floatBitsToUint(moved));
+
+    previous[id] = c;
+}
@@ -0,0 +1,79 @@
+#version 430 core
+
+// Bakes the starfield into a cube map array. The sky depends only on the ray
+// direction rd on S^3: the cube face comes from rd.xyz and the layers are slices
+// of rd.w, each with its own stars, which frag.glsl cross-fades between.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r11f_g11f_b10f, binding = 0) writeonly uniform imageCubeArray u_sky;
+
+uniform int u_face_size;
+uniform int u_layers;
+uniform float u_star_density;   // fraction of cells holding a star
+
+// cube map face convention of the GL spec, u and v in [-1, 1]
+vec3 faceDirection(int face, vec2 uv)
+{
+    if (face == 0) return vec3(1.0, -uv.y, -uv.x);
+    if (face == 1) return vec3(-1.0, -uv.y, uv.x);
+    if (face == 2) return vec3(uv.x, 1.0, uv.y);
+    if (face == 3) return vec3(uv.x, -1.0, -uv.y);
+    if (face == 4) return vec3(uv.x, -uv.y, 1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+float hash4(vec4 p)
+{
+    return fract(sin(dot(p, vec4(127.1, 311.7, 74.7, 269.5))) * 43758.5453);
+}
+
+vec3 sky(vec3 d, float layer, float w)
+{
+    float scale = 140.0;
+    vec3 cell = floor(d*scale);
+    vec3 local = fract(d*scale) - 0.5;
+
+    float rnd = hash4(vec4(cell, layer));
+
+    vec3 col = vec3(0.01,0.015,0.03);
+
+    if (rnd < u_star_density)
+    {
+        vec3 offset = vec3(
+            fract(rnd*13.1),
+            fract(rnd*7.7),
+            fract(rnd*19.3)
+        ) - 0.5;
+
+        float dist = length(local - offset);
+        float glow = exp(-1.0*dist);
+
+        float brightness = 0.7 + 2.0*fract(rnd*50.0);
+        col += vec3(1.0,0.95,0.9)*glow*brightness;
+    }
+
+    float band = exp(-6.0*abs(d.y));
+    col += vec3(0.15,0.18,0.25)*band*0.4;
+
+    // a second, fainter band around w = 0
+    col += vec3(0.2,0.1,0.22)*exp(-4.0*abs(w))*0.15;
+
+    return col;
+}
+
+void main()
+{
+    ivec3 id = ivec3(gl_GlobalInvocationID);
+    if (id.x >= u_face_size || id.y >= u_face_size)
+        return;
+
+    int face = id.z % 6;
+    int layer = id.z / 6;
+    float w = u_layers > 1 ? mix(-1.0, 1.0, float(layer) / float(u_layers - 1)) : 0.0;
+
+    vec2 uv = (vec2(id.xy) + 0.5) / float(u_face_size) * 2.0 - 1.0;
+    vec3 d = normalize(faceDirection(face, uv));
+
+    imageStore(u_sky, id, vec4(sky(d, float(layer), w), 1.0));
+}
@@ -0,0 +1,118 @@
+#version 430 core
+
+// Cross-section mode: cuts every ball by the hyperplane dot(x, u_slice_normal) =
+// u_slice_offset and appends a screen rectangle for each 3D ball left over to the
+// impostor instance list, seen from u_slice, a camera frame inside the hyperplane.
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+struct Impostor
+{
+    vec4 rect;     // ndc min.xy, max.xy
+    float depth;   // nearest possible t of the cross-section, as a depth value
+    uint sphere;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 6) writeonly buffer ImpostorBuffer
+{
+    Impostor impostors[];
+};
+
+// same command buffer as impostor_cull.glsl, only the impostor draw is used
+layout(std430, binding = 7) buffer CommandBuffer
+{
+    uint vertex_count;
+    uint instance_count;
+    uint first_vertex;
+    uint base_instance;
+};
+
+// columns right, up, front, eye, all in the hyperplane
+uniform mat4 u_slice;
+uniform vec4 u_slice_normal;
+uniform float u_slice_offset;
+uniform vec2 u_resolution;
+
+const float FOCAL = 2.0;       // must match frag.glsl
+const float SLICE_FAR = 4.0;   // must match slice_frag.glsl
+const float HALF_PI = 1.57079632679;
+const float BIG = 1e6;
+const float DEPTH_SLACK = 1e-3;
+
+// Slope range x/z covered by a ball of radius R around c in the (x, z) plane.
+bool axisBounds(float cx, float cz, float R, out float lo, out float hi)
+{
+    float L2 = cx * cx + cz * cz;
+    if (L2 <= R * R)
+    {
+        lo = -BIG;
+        hi = BIG;
+        return true;
+    }
+
+    float phi = atan(cx, cz);
+    float delta = asin(R / sqrt(L2));
+    float a0 = phi - delta;
+    float a1 = phi + delta;
+
+    if (a0 >= HALF_PI || a1 <= -HALF_PI) return false;
+
+    lo = a0 <= -HALF_PI ? -BIG : tan(a0);
+    hi = a1 >= HALF_PI ? BIG : tan(a1);
+    return true;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    // with its chord radius the ball is S^3 inside a round 4D ball, whose cut
+    // is a 3D ball that shrinks to nothing as the center leaves the hyperplane
+    vec4 c = spheres[id].center;
+    float r = spheres[id].radius;
+    float h = dot(c, u_slice_normal) - u_slice_offset;
+    if (abs(h) >= r) return;
+
+    float R = sqrt(r * r - h * h);
+    vec4 v = c - h * u_slice_normal - u_slice[3];
+    vec3 s = vec3(dot(v, u_slice[0]), dot(v, u_slice[1]), dot(v, u_slice[2]));
+
+    vec2 lo, hi;
+    if (!axisBounds(s.x, s.z, R, lo.x, hi.x)) return;
+    if (!axisBounds(s.y, s.z, R, lo.y, hi.y)) return;
+
+    // slope -> screenPos -> ndc, one pixel of slack for the rasterizer
+    vec2 scale = vec2(FOCAL) / vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec2 pad = 2.0 / u_resolution;
+    vec2 n_lo = max(lo * scale - pad, vec2(-1.0));
+    vec2 n_hi = min(hi * scale + pad, vec2(1.0));
+
+    if (any(greaterThanEqual(n_lo, n_hi))) return;
+
+    float t_near = max(length(s) - R - DEPTH_SLACK, 0.0);
+    if (t_near >= SLICE_FAR) return;
+
+    uint slot = atomicAdd(instance_count, 1u);
+    impostors[slot].rect = vec4(n_lo, n_hi);
+    impostors[slot].depth = t_near / SLICE_FAR;
+    impostors[slot].sphere = id;
+}
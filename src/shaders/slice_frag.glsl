@@ -0,0 +1,88 @@
+#version 460 core
+
+// Ray against one cross-section from slice_cull.glsl, an ordinary 3D ball inside
+// the slice hyperplane; t over SLICE_FAR is written as depth.
+
+in vec2 ndc;
+flat in uint sphere;
+flat in float near_depth;
+out vec4 FragColor;
+
+layout(depth_greater) out float gl_FragDepth;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer ParticleBuffer {
+    Sphere particles[];
+};
+
+// columns right, up, front, eye, all in the hyperplane
+uniform mat4 u_slice;
+uniform vec4 u_slice_normal;
+uniform float u_slice_offset;
+uniform vec2 u_resolution;
+
+const float focal = 2;
+const float SLICE_FAR = 4.0;   // beyond the far side of S^3, seen from the eye
+
+// same picking as frag.glsl
+layout(std430, binding = 11) buffer PickBuffer {
+    ivec2 pick_pixel;   // x < 0 when no pick is armed
+    int pick_radius;
+    uint pick_key;
+};
+
+#define PICK_INDEX_BITS 20
+
+void pick(ivec2 pixel, float t, int index)
+{
+    if (pick_pixel.x < 0 || index < 0 || index >= (1 << PICK_INDEX_BITS)) return;
+    if (any(greaterThan(abs(pixel - pick_pixel), ivec2(pick_radius)))) return;
+
+    uint depth = uint(clamp(t / SLICE_FAR, 0.0, 1.0) * 4095.0);
+    atomicMin(pick_key, (depth << PICK_INDEX_BITS) | uint(index));
+}
+
+void main()
+{
+    vec4 right = u_slice[0];
+    vec4 up = u_slice[1];
+    vec4 front = u_slice[2];
+    vec4 eye = u_slice[3];
+
+    // the marcher's ray, straight in the hyperplane
+    vec2 screenPos = ndc * vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec4 rd = normalize(screenPos.x*right + screenPos.y*up + focal*front);
+
+    vec4 c = particles[sphere].center;
+    float r = particles[sphere].radius;
+    float h = dot(c, u_slice_normal) - u_slice_offset;
+    float R2 = r*r - h*h;
+    vec4 center = c - h*u_slice_normal;
+
+    vec4 oc = eye - center;
+    float b = dot(oc, rd);
+    float disc = b*b - (dot(oc, oc) - R2);
+    if (disc < 0.0) discard;
+
+    float root = sqrt(disc);
+    if (root - b < 0.0) discard;
+
+    // from inside the ball the whole view is its color, as with the impostors
+    float t = max(-b - root, 0.0);
+
+    vec4 n = t > 0.0 ? (eye + t*rd - center) / sqrt(R2) : -rd;
+    float diff = max(dot(n, -front), 0.0);
+    float ambient = 0.18;
+
+    pick(ivec2(gl_FragCoord.xy), t, int(sphere));
+    FragColor = vec4(particles[sphere].color*(ambient + diff), 1.0);
+    gl_FragDepth = clamp(t / SLICE_FAR, near_depth, 1.0);
+}
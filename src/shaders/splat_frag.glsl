@@ -0,0 +1,18 @@
+#version 460 core
+
+// Additive gaussian footprint of a sub-pixel ball, depth tested against the
+// impostors so resolved spheres hide the splats behind them.
+
+flat in vec3 color;
+out vec4 FragColor;
+
+// a 2 pixel point covers four pixel centers at about |q|^2 = 0.5, whose weights
+// should sum to one
+const float FALLOFF = 2.0;
+const float NORMALIZE = 0.68;
+
+void main()
+{
+    vec2 q = gl_PointCoord * 2.0 - 1.0;
+    FragColor = vec4(color * (NORMALIZE * exp(-FALLOFF * dot(q, q))), 0.0);
+}
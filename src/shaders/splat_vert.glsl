@@ -0,0 +1,25 @@
+#version 460 core
+
+// One point per splat written by impostor_cull.glsl.
+
+struct Splat
+{
+    vec4 position;
+    vec4 color;
+};
+
+layout(std430, binding = 10) readonly buffer SplatBuffer
+{
+    Splat splats[];
+};
+
+flat out vec3 color;
+
+void main()
+{
+    Splat s = splats[gl_VertexID];
+
+    color = s.color.rgb;
+    gl_PointSize = s.position.w;
+    gl_Position = vec4(s.position.xy, s.position.z * 2.0 - 1.0, 1.0);
+}
@@ -0,0 +1,165 @@
+#version 460 core
+
+// Rebuilds the full image from this frame's checkerboard (or quarter) samples.
+// Pixels shaded this frame are copied. For the others each shaded neighbour's hit
+// distance is placed on S^3 along this pixel's ray and looked up in the previous
+// frame through the previous camera; the first place where the previous frame saw
+// the same distance (or sky for sky) supplies the color. Disoccluded and off
+// screen pixels fall back to the average of the neighbours. Alpha carries t, -1
+// for sky.
+
+out vec4 FragColor;
+
+uniform sampler2D u_current;   // this frame's samples, packed
+uniform sampler2D u_history;   // last resolved frame
+uniform bool u_history_valid;
+
+uniform int u_checker;         // 1 half the pixels, 2 a quarter
+uniform int u_frame_index;
+uniform vec2 u_resolution;
+
+// camera frames as columns: right, up, front, pos
+uniform mat4 u_camera;
+uniform mat4 u_prev_camera;
+
+const float focal = 2;
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+
+ivec2 quarterOffset(int frame)
+{
+    const ivec2 o[4] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 1));
+    return o[frame & 3];
+}
+
+bool shadedThisFrame(ivec2 p)
+{
+    if (u_checker == 1) return (p.x & 1) == ((p.y + u_frame_index) & 1);
+    return (p & 1) == quarterOffset(u_frame_index);
+}
+
+// sample of a pixel shaded this frame
+vec4 fetchShaded(ivec2 p)
+{
+    ivec2 sub = u_checker == 1 ? ivec2(p.x >> 1, p.y) : (p >> 1);
+    ivec2 size = ivec2(ceil(u_resolution / vec2(2.0, u_checker == 1 ? 1.0 : 2.0)));
+    return texelFetch(u_current, clamp(sub, ivec2(0), size - 1), 0);
+}
+
+vec4 rayDirection(mat4 camera, vec2 pixel)
+{
+    vec2 uv = (pixel / u_resolution * 2.0 - 1.0) * vec2(u_resolution.x / u_resolution.y, 1.0);
+    vec4 rd = normalize(uv.x*camera[0] + uv.y*camera[1] + focal*camera[2]);
+    return normalize(rd - camera[3]*dot(rd, camera[3]));
+}
+
+// previous frame pixel and distance at which the previous camera saw point q,
+// the long way round when the current hit is past the antipode
+bool reproject(vec4 q, bool long_way, out vec2 pixel, out float t_prev)
+{
+    vec4 cpos = u_prev_camera[3];
+    vec4 v = q - cpos*dot(q, cpos);
+    float g = acos(clamp(dot(q, cpos), -1.0, 1.0));
+
+    if (long_way)
+    {
+        v = -v;
+        g = TWO_PI - g;
+    }
+
+    vec3 local = vec3(dot(v, u_prev_camera[0]), dot(v, u_prev_camera[1]), dot(v, u_prev_camera[2]));
+    if (local.z <= 1e-4) return false;
+
+    vec2 uv = focal * local.xy / local.z;
+    vec2 ndc = uv / vec2(u_resolution.x / u_resolution.y, 1.0);
+    pixel = (ndc * 0.5 + 0.5) * u_resolution;
+    t_prev = g;
+
+    return all(greaterThanEqual(pixel, vec2(0.0))) && all(lessThan(pixel, u_resolution));
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    if (shadedThisFrame(p))
+    {
+        FragColor = fetchShaded(p);
+        return;
+    }
+
+    // the nearest pixels shaded this frame
+    ivec2 n[4];
+    if (u_checker == 1)
+    {
+        n[0] = p + ivec2(-1, 0); n[1] = p + ivec2(1, 0);
+        n[2] = p + ivec2(0, -1); n[3] = p + ivec2(0, 1);
+    }
+    else
+    {
+        ivec2 o = quarterOffset(u_frame_index);
+        ivec2 base = ((p - o) >> 1) * 2 + o;
+        n[0] = base; n[1] = base + ivec2(2, 0);
+        n[2] = base + ivec2(0, 2); n[3] = base + ivec2(2, 2);
+    }
+
+    vec4 s[4];
+    vec3 average = vec3(0.0);
+    float t_near = 1e9;
+    for (int i = 0; i < 4; i++)
+    {
+        s[i] = fetchShaded(n[i]);
+        average += 0.25 * s[i].rgb;
+        if (s[i].a >= 0.0) t_near = min(t_near, s[i].a);
+    }
+
+    vec4 spatial = vec4(average, t_near < 1e9 ? t_near : -1.0);
+
+    if (!u_history_valid)
+    {
+        FragColor = spatial;
+        return;
+    }
+
+    // each neighbour proposes what this pixel sees: a surface at its distance, or the sky
+    vec4 rd = rayDirection(u_camera, vec2(p) + 0.5);
+    for (int i = 0; i < 4; i++)
+    {
+        float t = s[i].a;
+        vec2 prev_pixel;
+        float t_expected;
+
+        if (t < 0.0)
+        {
+            // the sky only depends on the direction, seen from the previous camera
+            vec3 local = vec3(dot(rd, u_prev_camera[0]), dot(rd, u_prev_camera[1]), dot(rd, u_prev_camera[2]));
+            if (local.z <= 1e-4) continue;
+            prev_pixel = (focal * local.xy / local.z / vec2(u_resolution.x / u_resolution.y, 1.0) * 0.5 + 0.5) * u_resolution;
+            if (any(lessThan(prev_pixel, vec2(0.0))) || any(greaterThanEqual(prev_pixel, u_resolution))) continue;
+
+            vec4 history = texelFetch(u_history, ivec2(prev_pixel), 0);
+            if (history.a < 0.0)
+            {
+                FragColor = history;
+                return;
+            }
+            continue;
+        }
+
+        vec4 q = cos(t)*u_camera[3] + sin(t)*rd;
+        if (!reproject(q, t > PI, prev_pixel, t_expected)) continue;
+
+        vec4 history = texelFetch(u_history, ivec2(prev_pixel), 0);
+
+        // the previous frame must have seen a surface at the same place
+        float tolerance = 0.02 + 0.02 * t_expected;
+        if (history.a >= 0.0 && abs(history.a - t_expected) <= tolerance)
+        {
+            FragColor = vec4(history.rgb, t);
+            return;
+        }
+    }
+
+    // disoccluded or off screen last frame
+    FragColor = spatial;
+}
@@ -0,0 +1,175 @@
+#version 430 core
+
+// Appends each sphere to the per-tile lists of every screen tile its view cone
+// (and the cone of its antipodal image) overlaps. With several views (MultiView)
+// each one bins into the tiles under its own rectangle; tiles on a border or
+// under an inset keep the union, which is conservative for either view.
+
+#define TILE_SIZE 16
+#define MAX_PER_TILE 128
+
+layout(local_size_x = 64) in;
+
+struct Sphere
+{
+    vec4 center;
+    vec3 color;
+    float radius;
+    vec4 vel;
+    int material;   // MaterialLibrary layer, -1 for the flat color
+};
+
+layout(std430, binding = 0) readonly buffer SphereBuffer
+{
+    Sphere spheres[];
+};
+
+layout(std430, binding = 4) buffer TileCounts
+{
+    uint tile_counts[];
+};
+
+layout(std430, binding = 5) writeonly buffer TileLists
+{
+    uint tile_lists[];
+};
+
+#define MAX_VIEWS 4
+
+struct View
+{
+    mat4 camera;
+    vec4 rect;   // x, y, width, height in pixels
+};
+
+layout(std140, binding = 0) uniform ViewBlock
+{
+    View views[MAX_VIEWS];
+    int view_count;
+};
+
+uniform mat4 u_camera;       // the only view when view_count is 0
+uniform vec2 u_resolution;
+uniform ivec2 u_tiles;
+uniform float u_tolerance;   // hit threshold of the marcher
+
+// the view being binned
+vec4 view_rect;
+ivec2 view_tiles_lo;
+ivec2 view_tiles_hi;
+
+const float FOCAL = 2.0;      // must match frag.glsl
+const float PI = 3.14159265359;
+const float HALF_PI = 1.57079632679;
+const float BIG = 1e6;
+
+// Slope range x/z covered by a ball of radius R around c in the (x, z) plane.
+bool axisBounds(float cx, float cz, float R, out float lo, out float hi)
+{
+    float L2 = cx * cx + cz * cz;
+    if (L2 <= R * R)
+    {
+        lo = -BIG;
+        hi = BIG;
+        return true;
+    }
+
+    float phi = atan(cx, cz);
+    float delta = asin(R / sqrt(L2));
+    float a0 = phi - delta;
+    float a1 = phi + delta;
+
+    if (a0 >= HALF_PI || a1 <= -HALF_PI) return false;
+
+    lo = a0 <= -HALF_PI ? -BIG : tan(a0);
+    hi = a1 >= HALF_PI ? BIG : tan(a1);
+    return true;
+}
+
+void appendRect(uint id, ivec2 lo, ivec2 hi)
+{
+    lo = max(lo, view_tiles_lo);
+    hi = min(hi, view_tiles_hi);
+
+    for (int ty = lo.y; ty <= hi.y; ty++)
+    {
+        for (int tx = lo.x; tx <= hi.x; tx++)
+        {
+            uint tile = uint(ty * u_tiles.x + tx);
+            uint slot = atomicAdd(tile_counts[tile], 1u);
+            if (slot < MAX_PER_TILE)
+                tile_lists[tile * MAX_PER_TILE + slot] = id;
+        }
+    }
+}
+
+// Unit-distance cone around `axis` with half-angle asin(R), in camera coordinates.
+void binCone(uint id, vec3 axis, float R)
+{
+    vec2 lo, hi;
+    if (!axisBounds(axis.x, axis.z, R, lo.x, hi.x)) return;
+    if (!axisBounds(axis.y, axis.z, R, lo.y, hi.y)) return;
+
+    float aspect = view_rect.z / view_rect.w;
+
+    // slope -> screenPos -> pixels, same mapping as vertex.glsl
+    vec2 s_lo = clamp(FOCAL * lo / vec2(aspect, 1.0), -1.0, 1.0);
+    vec2 s_hi = clamp(FOCAL * hi / vec2(aspect, 1.0), -1.0, 1.0);
+
+    vec2 p_lo = view_rect.xy + (s_lo * 0.5 + 0.5) * view_rect.zw;
+    vec2 p_hi = view_rect.xy + (s_hi * 0.5 + 0.5) * view_rect.zw;
+
+    appendRect(id, ivec2(floor(p_lo / TILE_SIZE)), ivec2(floor(p_hi / TILE_SIZE)));
+}
+
+void binView(uint id, mat4 camera)
+{
+    vec4 c = spheres[id].center;
+
+    float cw = dot(c, camera[3]);
+    vec3 u = vec3(dot(c, camera[0]), dot(c, camera[1]), dot(c, camera[2]));
+    float s = length(u);
+    float D = atan(s, cw);
+
+    // the marcher measures chord distance, turn radius + tolerance into an angle
+    float chord = min(spheres[id].radius + u_tolerance, 2.0);
+    float r = 2.0 * asin(0.5 * chord);
+
+    // camera inside the ball, or the ball wraps over the antipode: every ray can hit it
+    if (D <= r || D + r >= PI)
+    {
+        appendRect(id, view_tiles_lo, view_tiles_hi);
+        return;
+    }
+
+    float R = min(sin(r) / sin(D), 1.0);
+    vec3 axis = u / s;
+
+    binCone(id, axis, R);
+    binCone(id, -axis, R);
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= spheres.length())
+        return;
+
+    if (view_count == 0)
+    {
+        view_rect = vec4(0.0, 0.0, u_resolution);
+        view_tiles_lo = ivec2(0);
+        view_tiles_hi = u_tiles - 1;
+        binView(id, u_camera);
+        return;
+    }
+
+    for (int v = 0; v < view_count; v++)
+    {
+        view_rect = views[v].rect;
+        view_tiles_lo = max(ivec2(floor(view_rect.xy / TILE_SIZE)), ivec2(0));
+        view_tiles_hi = min(ivec2(floor((view_rect.xy + view_rect.zw - 1.0) / TILE_SIZE)), u_tiles - 1);
+        binView(id, views[v].camera);
+    }
+}